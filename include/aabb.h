@@ -0,0 +1,60 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include "utils.h"
+#include "ray.h"
+#include <utility>
+
+// Caixa Alinhada aos Eixos (Axis-Aligned Bounding Box)
+// Base da estrutura de aceleração: se o raio não bate na caixa, não bate em nada dentro dela.
+class aabb {
+    public:
+        point3 minimum;
+        point3 maximum;
+
+        // Caixa vazia: mínimo em +inf e máximo em -inf (qualquer união a substitui)
+        aabb() : minimum(infinity, infinity, infinity), maximum(-infinity, -infinity, -infinity) {}
+        aabb(const point3& a, const point3& b) : minimum(a), maximum(b) {}
+
+        bool is_empty() const { return minimum.x() > maximum.x(); }
+
+        point3 centroid() const { return 0.5 * (minimum + maximum); }
+
+        // Área de superfície (usada na heurística de custo SAH)
+        double surface_area() const {
+            if (is_empty()) return 0.0;
+            vec3 d = maximum - minimum;
+            return 2.0 * (d.x()*d.y() + d.y()*d.z() + d.z()*d.x());
+        }
+
+        // Teste de "slabs": intersecta os três pares de planos e verifica se os intervalos se sobrepõem.
+        // inv_dir = 1/direção, calculado uma vez por raio pelo chamador.
+        bool hit(const ray& r, const vec3& inv_dir, double t_min, double t_max) const {
+            for (int a = 0; a < 3; a++) {
+                auto t0 = (minimum[a] - r.orig[a]) * inv_dir[a];
+                auto t1 = (maximum[a] - r.orig[a]) * inv_dir[a];
+                if (inv_dir[a] < 0.0) std::swap(t0, t1);
+                t_min = t0 > t_min ? t0 : t_min;
+                t_max = t1 < t_max ? t1 : t_max;
+                if (t_max < t_min) return false;
+            }
+            return true;
+        }
+
+        bool hit(const ray& r, double t_min, double t_max) const {
+            vec3 d = r.direction();
+            return hit(r, vec3(1.0/d.x(), 1.0/d.y(), 1.0/d.z()), t_min, t_max);
+        }
+};
+
+inline aabb surrounding_box(const aabb& box0, const aabb& box1) {
+    point3 small(fmin(box0.minimum.x(), box1.minimum.x()),
+                 fmin(box0.minimum.y(), box1.minimum.y()),
+                 fmin(box0.minimum.z(), box1.minimum.z()));
+    point3 big(fmax(box0.maximum.x(), box1.maximum.x()),
+               fmax(box0.maximum.y(), box1.maximum.y()),
+               fmax(box0.maximum.z(), box1.maximum.z()));
+    return aabb(small, big);
+}
+
+#endif
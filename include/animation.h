@@ -0,0 +1,180 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "utils.h"
+#include "mat4.h"
+#include "camera.h"
+#include "instance.h"
+#include "bvh.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+// --- Animação por Quadros-Chave (Keyframes) ---
+//
+// Cada trilha guarda chaves ordenadas por tempo e interpola linearmente entre elas.
+// Antes da primeira e depois da última chave o valor fica constante.
+
+// Encontra o par de chaves em volta de 'time' e o peso de interpolação entre elas
+template <typename Key>
+inline void find_keys(const std::vector<Key>& keys, double time, int& k0, int& k1, double& alpha) {
+    k0 = k1 = 0;
+    alpha = 0.0;
+    if (keys.size() < 2 || time <= keys.front().time) return;
+    if (time >= keys.back().time) {
+        k0 = k1 = static_cast<int>(keys.size()) - 1;
+        return;
+    }
+    while (keys[k0 + 1].time < time) k0++;
+    k1 = k0 + 1;
+    alpha = (time - keys[k0].time) / (keys[k1].time - keys[k0].time);
+}
+
+template <typename Key>
+inline void insert_key(std::vector<Key>& keys, const Key& key) {
+    auto it = std::upper_bound(keys.begin(), keys.end(), key,
+                               [](const Key& a, const Key& b) { return a.time < b.time; });
+    keys.insert(it, key);
+}
+
+// Chave de transformação: Escala, depois Rotação (eixo arbitrário), depois Translação
+struct transform_key {
+    double time;
+    vec3 translation;
+    vec3 axis;
+    double angle; // Radianos. Interpolado linearmente, então 0 -> 2*pi dá uma volta completa
+    vec3 scale;
+};
+
+class transform_track {
+    public:
+        std::vector<transform_key> keys;
+
+        void add_key(double time, const vec3& translation, const vec3& axis = vec3(0,1,0),
+                     double angle_radians = 0.0, const vec3& scale = vec3(1,1,1)) {
+            insert_key(keys, transform_key{time, translation, axis, angle_radians, scale});
+        }
+
+        bool empty() const { return keys.empty(); }
+
+        // Monta M = T * R * S e a inversa analítica M^-1 = S^-1 * R^-1 * T^-1
+        void evaluate(double time, mat4& m, mat4& m_inv) const {
+            if (keys.empty()) {
+                m = m_inv = mat4();
+                return;
+            }
+
+            int k0, k1;
+            double a;
+            find_keys(keys, time, k0, k1, a);
+            const transform_key& p = keys[k0];
+            const transform_key& q = keys[k1];
+
+            vec3 translation = (1-a)*p.translation + a*q.translation;
+            vec3 scale = (1-a)*p.scale + a*q.scale;
+            vec3 axis = (1-a)*p.axis + a*q.axis;
+            double angle = (1-a)*p.angle + a*q.angle;
+
+            vec3 inv_scale(safe_inverse(scale.x()), safe_inverse(scale.y()), safe_inverse(scale.z()));
+
+            m = mat4::translate(translation) * mat4::rotate(axis, angle) * mat4::scale(scale);
+            m_inv = mat4::scale(inv_scale) * mat4::rotate(axis, -angle) * mat4::translate(-translation);
+        }
+
+    private:
+        static double safe_inverse(double x) {
+            return fabs(x) < 1e-12 ? 0.0 : 1.0 / x;
+        }
+};
+
+// Chave de câmera: os mesmos parâmetros do construtor de camera
+struct camera_key {
+    double time;
+    point3 lookfrom;
+    point3 lookat;
+    vec3 vup;
+    double vfov;
+};
+
+class camera_track {
+    public:
+        std::vector<camera_key> keys;
+
+        void add_key(double time, const point3& lookfrom, const point3& lookat,
+                     const vec3& vup, double vfov) {
+            insert_key(keys, camera_key{time, lookfrom, lookat, vup, vfov});
+        }
+
+        bool empty() const { return keys.empty(); }
+
+        // Câmera no instante 'time' (foco na distância até o alvo, como na main)
+        camera evaluate(double time, double aspect_ratio, double aperture = 0.0) const {
+            int k0, k1;
+            double a;
+            find_keys(keys, time, k0, k1, a);
+            const camera_key& p = keys[k0];
+            const camera_key& q = keys[k1];
+
+            point3 lookfrom = (1-a)*p.lookfrom + a*q.lookfrom;
+            point3 lookat = (1-a)*p.lookat + a*q.lookat;
+            vec3 vup = (1-a)*p.vup + a*q.vup;
+            double vfov = (1-a)*p.vfov + a*q.vfov;
+
+            auto dist_to_focus = (lookfrom - lookat).length();
+            return camera(lookfrom, lookat, vup, vfov, aspect_ratio, aperture, dist_to_focus);
+        }
+};
+
+// Liga trilhas às instâncias da cena e mantém a BVH em dia a cada quadro.
+// A trilha é aplicada no espaço do mundo, depois da transformação original da instância:
+//   M(t) = trilha(t) * M_original
+class scene_animation {
+    public:
+        struct binding {
+            shared_ptr<instance> target;
+            transform_track track;
+            mat4 base;
+            mat4 base_inv;
+        };
+
+        std::vector<binding> bindings;
+        camera_track camera_keys;
+
+        void animate(shared_ptr<instance> target, const transform_track& track) {
+            bindings.push_back(binding{target, track, target->transform_matrix, target->inverse_matrix});
+        }
+
+        // Atualiza as transformações para o instante 'time' e reajusta a BVH
+        void apply(double time, bvh& accel) const {
+            mat4 m, m_inv;
+            for (const auto& b : bindings) {
+                b.track.evaluate(time, m, m_inv);
+                b.target->set_transform(m * b.base, b.base_inv * m_inv);
+            }
+            accel.update();
+        }
+
+        // Vetores de movimento: para cada instância animada, a matriz que leva um ponto dela no
+        // instante 'time' para onde o mesmo ponto estava em 'prev_time'. Objetos fora do mapa
+        // não se moveram.
+        std::unordered_map<const hittable*, mat4> motion_between(double prev_time, double time) const {
+            std::unordered_map<const hittable*, mat4> motion;
+            mat4 m_prev, m_prev_inv, m, m_inv;
+            for (const auto& b : bindings) {
+                b.track.evaluate(prev_time, m_prev, m_prev_inv);
+                b.track.evaluate(time, m, m_inv);
+                // M_prev * M^-1 = trilha(prev) * base * base^-1 * trilha(time)^-1
+                motion[b.target.get()] = m_prev * m_inv;
+            }
+            return motion;
+        }
+
+        bool has_camera() const { return !camera_keys.empty(); }
+
+        camera camera_at(double time, double aspect_ratio) const {
+            return camera_keys.evaluate(time, aspect_ratio);
+        }
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+using std::shared_ptr;
+
+// --- Arena da Cena ---
+//
+// Com make_shared, cada esfera, material e textura vira um bloco separado no heap com seu
+// próprio bloco de controle e contador atômico. A arena aloca os objetos em sequência dentro
+// de blocos grandes e devolve shared_ptr SEM bloco de controle (construtor de "aliasing" com
+// dono vazio): nenhuma alocação por objeto, copiar o ponteiro não mexe em contador atômico,
+// objetos vizinhos ficam próximos na memória e destruir a arena libera tudo de uma vez.
+//
+// Os ponteiros devolvidos não são donos: quem manda no tempo de vida é a arena.
+// Eles não podem ser usados depois que a arena (normalmente, a cena) for destruída.
+class scene_arena {
+    public:
+        explicit scene_arena(size_t block = 1 << 20) : block_size(block) {}
+
+        scene_arena(const scene_arena&) = delete;
+        scene_arena& operator=(const scene_arena&) = delete;
+
+        // Destrói na ordem inversa de criação (quem foi criado depois pode usar os anteriores)
+        ~scene_arena() {
+            for (size_t i = destructors.size(); i-- > 0;)
+                destructors[i].destroy(destructors[i].object);
+            for (char* b : blocks) std::free(b);
+        }
+
+        // Constrói um T dentro da arena
+        template <typename T, typename... Args>
+        shared_ptr<T> make(Args&&... args) {
+            static_assert(alignof(T) <= alignof(std::max_align_t), "alinhamento maior que o do malloc");
+            void* mem = allocate(sizeof(T), alignof(T));
+            T* obj = new (mem) T(std::forward<Args>(args)...);
+            destructors.push_back(destructor_entry{obj, [](void* p) { static_cast<T*>(p)->~T(); }});
+            return shared_ptr<T>(shared_ptr<T>(), obj);
+        }
+
+        size_t bytes_used() const { return used; }
+        size_t bytes_reserved() const { return reserved; }
+        size_t object_count() const { return destructors.size(); }
+
+    private:
+        struct destructor_entry {
+            void* object;
+            void (*destroy)(void*);
+        };
+
+        size_t block_size;
+        std::vector<char*> blocks;
+        std::vector<destructor_entry> destructors;
+        size_t offset = 0; // Posição livre no último bloco
+        size_t capacity = 0;
+        size_t used = 0;
+        size_t reserved = 0;
+
+        void* allocate(size_t size, size_t align) {
+            size_t start = (offset + align - 1) & ~(align - 1);
+            if (blocks.empty() || start + size > capacity) {
+                // malloc já devolve memória alinhada para qualquer tipo básico
+                capacity = size > block_size ? size : block_size;
+                char* block = static_cast<char*>(std::malloc(capacity));
+                if (!block) throw std::bad_alloc();
+                blocks.push_back(block);
+                reserved += capacity;
+                start = 0;
+            }
+            offset = start + size;
+            used += size;
+            return blocks.back() + start;
+        }
+};
+
+// Tabela de handles de 32 bits: índice compacto -> objeto.
+// Estruturas com muitos elementos (faces de malha, instâncias) guardam o handle (4 bytes)
+// em vez de um shared_ptr (16 bytes + contador atômico).
+template <typename T>
+class handle_table {
+    public:
+        static const uint32_t invalid = 0xffffffffu;
+
+        std::vector<T*> items;
+        std::vector<shared_ptr<T>> owners; // Mantém vivos os objetos referenciados
+
+        uint32_t add(shared_ptr<T> obj) {
+            for (uint32_t i = 0; i < items.size(); i++)
+                if (items[i] == obj.get()) return i;
+            items.push_back(obj.get());
+            owners.push_back(obj);
+            return static_cast<uint32_t>(items.size() - 1);
+        }
+
+        T* operator[](uint32_t handle) const { return items[handle]; }
+        size_t size() const { return items.size(); }
+};
+
+#endif
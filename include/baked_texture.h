@@ -0,0 +1,262 @@
+#ifndef BAKED_TEXTURE_H
+#define BAKED_TEXTURE_H
+
+#include "utils.h"
+#include "texture.h"
+#include "hittable.h"
+#include "camera.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// --- Texturas Pré-Calculadas (Baking) ---
+//
+// Uma textura procedural (xadrez com três senos, ou uma cadeia de texturas aninhadas) é avaliada
+// uma vez só, no carregamento da cena, numa grade de resolução limitada; o sombreamento passa a
+// fazer uma busca filtrada (bilinear/trilinear) em vez da cadeia de value() virtuais.
+//   - Modo UV: grade 2D de res x res sobre [0,1)^2, com repetição. Só para texturas que
+//     dependem apenas de (u, v).
+//   - Modo sólido: grade 3D esparsa em blocos de 4x4x4 células, alocados só em volta dos pontos
+//     de superfície informados (normalmente os que a câmera vê, ver collect_surface_points).
+//     Os cantos de um bloco são avaliados projetados no plano tangente do ponto que criou o
+//     bloco: a textura só é consultada na superfície, e uma textura sólida que muda de valor
+//     bem na superfície (o xadrez com sin(10y) no chão em y = 0) não é misturada com o outro lado.
+//     Fora dos blocos a textura original é avaliada (conta em 'fallbacks').
+// Cores guardadas em RGB de 8 bits (a textura original deve ficar em [0, 1]).
+// A grade suaviza bordas duras (o xadrez vira uma rampa de uma célula): bake() mede o erro
+// contra a textura analítica em pontos sorteados e guarda em 'error'.
+
+// Ponto de superfície onde a textura vai ser consultada
+struct surface_sample {
+    point3 p;
+    vec3 normal; // Unitária
+};
+
+struct bake_error {
+    double max_abs = 0.0; // Maior diferença absoluta num canal
+    double rms = 0.0;     // Raiz da média dos quadrados (todos os canais)
+    int probes = 0;
+};
+
+class baked_texture : public texture {
+    public:
+        shared_ptr<texture> source;
+        bake_error error;
+        mutable std::atomic<long> fallbacks{0}; // Buscas fora dos blocos (modo sólido)
+
+        explicit baked_texture(shared_ptr<texture> src) : source(src) {}
+
+        // Modo UV: grade res x res
+        void bake_uv(int res, int probes = 4096) {
+            solid = false;
+            uv_res = res;
+            uv_texels.assign(static_cast<size_t>(res) * res * 3, 0);
+            for (int y = 0; y < res; y++)
+                for (int x = 0; x < res; x++)
+                    store(&uv_texels[(static_cast<size_t>(y) * res + x) * 3],
+                          source->value((x + 0.5) / res, (y + 0.5) / res, point3(0, 0, 0)));
+
+            error = bake_error();
+            for (int k = 0; k < probes; k++) {
+                double u = random_double(), v = random_double();
+                add_error(source->value(u, v, point3(0, 0, 0)), value(u, v, point3(0, 0, 0)));
+            }
+            finish_error();
+        }
+
+        // Modo sólido: células de 'cell' unidades; um bloco (e seus vizinhos) por ponto de superfície.
+        // O erro é medido nos próprios pontos de superfície (sorteados).
+        void bake_solid(double cell, const std::vector<surface_sample>& surface, int probes = 4096) {
+            solid = true;
+            cell_size = cell;
+            slot_keys.assign(1024, empty_key);
+            slot_bricks.assign(1024, 0);
+            brick_texels.clear();
+
+            inv_cell = 1.0 / cell;
+            double brick_extent = cell * brick_cells;
+            for (const surface_sample& sample : surface) {
+                const point3& p = sample.p;
+                int bx = brick_coord(p.x()), by = brick_coord(p.y()), bz = brick_coord(p.z());
+                // Mais os vizinhos do lado mais próximo (margem de meio bloco em volta do ponto)
+                for (int dz = -1; dz <= 1; dz++)
+                    for (int dy = -1; dy <= 1; dy++)
+                        for (int dx = -1; dx <= 1; dx++)
+                            if (fabs(p[0] - (bx + dx + 0.5) * brick_extent) < brick_extent
+                             && fabs(p[1] - (by + dy + 0.5) * brick_extent) < brick_extent
+                             && fabs(p[2] - (bz + dz + 0.5) * brick_extent) < brick_extent)
+                                add_brick(bx + dx, by + dy, bz + dz, sample);
+            }
+
+            error = bake_error();
+            for (int k = 0; k < probes && !surface.empty(); k++) {
+                const point3& p = surface[static_cast<size_t>(random_double() * surface.size()) % surface.size()].p;
+                add_error(source->value(0, 0, p), value(0, 0, p));
+            }
+            finish_error();
+            fallbacks = 0;
+        }
+
+        size_t brick_count() const { return solid ? brick_texels.size() / brick_bytes() : 0; }
+        size_t memory_bytes() const {
+            return uv_texels.capacity() + brick_texels.capacity()
+                 + slot_keys.capacity() * sizeof(uint64_t) + slot_bricks.capacity() * sizeof(uint32_t);
+        }
+
+        virtual color value(double u, double v, const point3& p) const override {
+            if (!solid) return uv_res > 0 ? lookup_uv(u, v) : source->value(u, v, p);
+
+            // Célula (ix, iy, iz) e bloco = célula / 4 (deslocamento aritmético arredonda para baixo)
+            double x = p.x() * inv_cell, y = p.y() * inv_cell, z = p.z() * inv_cell;
+            int ix = floor_int(x), iy = floor_int(y), iz = floor_int(z);
+            int bx = ix >> brick_shift, by = iy >> brick_shift, bz = iz >> brick_shift;
+            size_t slot = find_slot(brick_key(bx, by, bz));
+            if (slot_keys[slot] == empty_key) {
+                fallbacks.fetch_add(1, std::memory_order_relaxed);
+                return source->value(u, v, p);
+            }
+
+            // Trilinear entre os cantos das células; o bloco guarda (4+1)^3 cantos, então a busca
+            // nunca sai dele
+            const unsigned char* b = &brick_texels[slot_bricks[slot] * brick_bytes()];
+            int x0 = ix - (bx << brick_shift), y0 = iy - (by << brick_shift), z0 = iz - (bz << brick_shift);
+            double fx = x - ix, fy = y - iy, fz = z - iz;
+
+            const unsigned char* c = &b[corner_index(x0, y0, z0) * 3];
+            double r = 0, g = 0, bl = 0;
+            for (int k = 0; k < 8; k++) {
+                int dx = k & 1, dy = (k >> 1) & 1, dz = k >> 2;
+                double w = (dx ? fx : 1 - fx) * (dy ? fy : 1 - fy) * (dz ? fz : 1 - fz);
+                const unsigned char* t = c + corner_index(dx, dy, dz) * 3;
+                r += w * t[0];
+                g += w * t[1];
+                bl += w * t[2];
+            }
+            return color(r, g, bl) * (1.0 / 255.0);
+        }
+
+    private:
+        static const int brick_shift = 2;
+        static const int brick_cells = 1 << brick_shift;
+        static const int brick_corners = brick_cells + 1;
+
+        bool solid = false;
+        int uv_res = 0;
+        std::vector<unsigned char> uv_texels;
+        double cell_size = 1.0;
+        double inv_cell = 1.0;
+        // Tabela hash aberta (sondagem linear, tamanho potência de 2): chave do bloco -> índice do
+        // bloco em brick_texels. Uma busca costuma tocar uma linha de cache só.
+        static const uint64_t empty_key = ~uint64_t(0);
+        std::vector<uint64_t> slot_keys;
+        std::vector<uint32_t> slot_bricks;
+        std::vector<unsigned char> brick_texels;
+
+        static size_t brick_bytes() { return brick_corners * brick_corners * brick_corners * 3; }
+        static int corner_index(int x, int y, int z) { return (z * brick_corners + y) * brick_corners + x; }
+        int brick_coord(double x) const { return floor_int(x * inv_cell) >> brick_shift; }
+
+        // floor() sem chamar a libm (sem SSE4.1, floor não vira uma instrução)
+        static int floor_int(double x) {
+            int i = static_cast<int>(x);
+            return x < i ? i - 1 : i;
+        }
+
+        // 21 bits por eixo (com sinal, deslocado)
+        static uint64_t brick_key(int x, int y, int z) {
+            const int64_t bias = 1 << 20;
+            return (uint64_t(x + bias) << 42) | (uint64_t(y + bias) << 21) | uint64_t(z + bias);
+        }
+
+        // Posição da chave, ou da vaga vazia onde ela entraria
+        size_t find_slot(uint64_t key) const {
+            size_t mask = slot_keys.size() - 1;
+            size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+            while (slot_keys[slot] != key && slot_keys[slot] != empty_key) slot = (slot + 1) & mask;
+            return slot;
+        }
+
+        void grow() {
+            std::vector<uint64_t> old_keys(slot_keys.size() * 2, empty_key);
+            std::vector<uint32_t> old_bricks(slot_bricks.size() * 2, 0);
+            old_keys.swap(slot_keys);
+            old_bricks.swap(slot_bricks);
+            for (size_t k = 0; k < old_keys.size(); k++) {
+                if (old_keys[k] == empty_key) continue;
+                size_t slot = find_slot(old_keys[k]);
+                slot_keys[slot] = old_keys[k];
+                slot_bricks[slot] = old_bricks[k];
+            }
+        }
+
+        void add_brick(int bx, int by, int bz, const surface_sample& plane) {
+            uint64_t key = brick_key(bx, by, bz);
+            size_t slot = find_slot(key);
+            if (slot_keys[slot] == key) return;
+            uint32_t index = static_cast<uint32_t>(brick_count());
+            slot_keys[slot] = key;
+            slot_bricks[slot] = index;
+            if (2 * (index + 1) > slot_keys.size()) grow();
+            brick_texels.resize(brick_texels.size() + brick_bytes());
+            unsigned char* b = &brick_texels[index * brick_bytes()];
+            for (int z = 0; z < brick_corners; z++)
+                for (int y = 0; y < brick_corners; y++)
+                    for (int x = 0; x < brick_corners; x++) {
+                        point3 p((bx * brick_cells + x) * cell_size, (by * brick_cells + y) * cell_size,
+                                 (bz * brick_cells + z) * cell_size);
+                        p = p - dot(p - plane.p, plane.normal) * plane.normal;
+                        store(&b[corner_index(x, y, z) * 3], source->value(0, 0, p));
+                    }
+        }
+
+        color lookup_uv(double u, double v) const {
+            double x = (u - floor(u)) * uv_res - 0.5;
+            double y = (v - floor(v)) * uv_res - 0.5;
+            int x0 = static_cast<int>(floor(x)), y0 = static_cast<int>(floor(y));
+            double fx = x - x0, fy = y - y0;
+            int x1 = (x0 + 1) % uv_res, y1 = (y0 + 1) % uv_res;
+            x0 = (x0 + uv_res) % uv_res;
+            y0 = (y0 + uv_res) % uv_res;
+            auto at = [&](int i, int j) { return load(&uv_texels[(static_cast<size_t>(j) * uv_res + i) * 3]); };
+            return (1 - fy) * ((1 - fx) * at(x0, y0) + fx * at(x1, y0)) + fy * ((1 - fx) * at(x0, y1) + fx * at(x1, y1));
+        }
+
+        static void store(unsigned char* out, const color& c) {
+            for (int k = 0; k < 3; k++)
+                out[k] = static_cast<unsigned char>(clamp(c[k], 0.0, 1.0) * 255.0 + 0.5);
+        }
+
+        static color load(const unsigned char* in) { return color(in[0], in[1], in[2]) / 255.0; }
+
+        void add_error(const color& exact, const color& baked) {
+            for (int k = 0; k < 3; k++) {
+                double d = fabs(exact[k] - baked[k]);
+                error.max_abs = fmax(error.max_abs, d);
+                error.rms += d * d;
+            }
+            error.probes++;
+        }
+
+        void finish_error() {
+            if (error.probes > 0) error.rms = sqrt(error.rms / (3.0 * error.probes));
+        }
+};
+
+// Pontos de superfície com o material 'mat' vistos por uma câmera numa grade w x h (um raio por
+// pixel, no centro): onde vale a pena assar uma textura sólida.
+inline std::vector<surface_sample> collect_surface_points(const camera& cam, const hittable& world,
+                                                          const material* mat, int w, int h) {
+    std::vector<surface_sample> points;
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            ray r = cam.get_ray((i + 0.5) / w, (j + 0.5) / h);
+            hit_record rec;
+            if (world.hit(r, 0.001, infinity, rec) && rec.mat_ptr == mat)
+                points.push_back(surface_sample{rec.p, unit_vector(rec.normal)});
+        }
+    }
+    return points;
+}
+
+#endif
@@ -0,0 +1,285 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include "utils.h"
+#include "renderer.h"
+#include "framebuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --- Render com Orçamento de Tempo ---
+//
+// Para prévias importa o relógio, não o spp: quem chama dá um orçamento (ex: 200 ms) e o render
+// decide o resto.
+//   1. Escala da resolução: a partir da vazão medida (amostras/ms, guardada em budget_state entre
+//      quadros), a passada de 1 spp deve caber em ~40% do orçamento.
+//   2. Passada inicial de grossa para fina (1 pixel a cada 4, depois a cada 2, depois o resto):
+//      se o prazo chegar no meio, os pixels feitos ficam espalhados pela imagem toda.
+//   3. Passadas por importância: blocos de 8x8 com mais variância e mais contraste com os
+//      vizinhos (bordas) recebem +1 spp primeiro.
+//   4. No prazo (descontado o custo medido da etapa final), nenhum bloco novo começa; buracos são
+//      preenchidos (pull-push) e a imagem é ampliada (bilinear) para a resolução pedida.
+// O prazo é checado antes de cada bloco: o estouro máximo é o tempo de um bloco.
+
+struct budget_settings {
+    double budget_ms = 200.0;
+    int max_spp = 64;           // Teto de amostras por pixel (na resolução escolhida)
+    double min_scale = 0.125;   // Menor fração da resolução pedida
+    double first_pass_share = 0.4;
+    double refine_fraction = 0.25; // Fração dos blocos refinada em cada passada por importância
+    int block_size = 8;
+};
+
+// Medidas que sobrevivem entre quadros (a próxima prévia já começa com a escala certa)
+struct budget_state {
+    double samples_per_ms = 0.0; // 0 = ainda não medida
+    double resolve_ms = 0.0;     // Custo da etapa final (preencher + ampliar)
+
+    void observe(long samples, double ms) {
+        if (samples <= 0 || ms <= 0) return;
+        double rate = samples / ms;
+        samples_per_ms = samples_per_ms > 0 ? 0.5 * samples_per_ms + 0.5 * rate : rate;
+    }
+};
+
+struct budget_report {
+    double scale = 1.0;
+    int width = 0, height = 0; // Resolução efetivamente traçada
+    int passes = 0;
+    long samples = 0;
+    double coverage = 0.0;     // Fração dos pixels (na resolução traçada) com pelo menos uma amostra
+    double render_ms = 0.0;
+    double resolve_ms = 0.0;
+    double elapsed_ms = 0.0;
+};
+
+// Chama fn(k) para k em [0, count), distribuindo entre as threads por um contador atômico
+template <typename ItemFn>
+void parallel_items(int count, int threads, ItemFn fn) {
+    if (count <= 0) return;
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        for (int k = next++; k < count; k = next++) fn(k);
+    };
+    int n = std::min(resolve_thread_count(threads), count);
+    std::vector<std::thread> pool;
+    for (int t = 1; t < n; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+}
+
+// Preenche os pixels sem amostra (peso 0) com a média dos vizinhos em níveis cada vez mais
+// grossos (pull), depois desce interpolando (push)
+inline void pull_push_fill(std::vector<color>& image, std::vector<double>& weight, int w, int h) {
+    if (w <= 1 && h <= 1) return;
+    int cw = (w + 1) / 2, ch = (h + 1) / 2;
+    std::vector<color> coarse(static_cast<size_t>(cw) * ch, color(0, 0, 0));
+    std::vector<double> coarse_weight(coarse.size(), 0.0);
+    bool holes = false;
+    for (int j = 0; j < h; j++)
+        for (int i = 0; i < w; i++) {
+            size_t k = static_cast<size_t>(j) * w + i, c = static_cast<size_t>(j / 2) * cw + i / 2;
+            coarse[c] += weight[k] * image[k];
+            coarse_weight[c] += weight[k];
+            if (weight[k] <= 0) holes = true;
+        }
+    if (!holes) return;
+    for (size_t c = 0; c < coarse.size(); c++) {
+        if (coarse_weight[c] > 0) coarse[c] = coarse[c] / coarse_weight[c];
+        coarse_weight[c] = std::min(1.0, coarse_weight[c]);
+    }
+    pull_push_fill(coarse, coarse_weight, cw, ch);
+    for (int j = 0; j < h; j++)
+        for (int i = 0; i < w; i++) {
+            size_t k = static_cast<size_t>(j) * w + i;
+            if (weight[k] > 0) continue;
+            image[k] = coarse[static_cast<size_t>(j / 2) * cw + i / 2];
+            weight[k] = 1.0;
+        }
+}
+
+// Renderiza em 'out' (o tamanho de 'out' é a resolução pedida) dentro de bs.budget_ms.
+// Cada pixel de 'out' recebe a cor final com samples = 1 (sem AOVs: a imagem é ampliada, as guias
+// do denoiser não). Se 'stats' não for nulo, soma nele os raios por profundidade, como render_frame.
+inline budget_report render_budgeted(const camera& cam, const hittable& world, const std::vector<PointLight>& lights,
+                                     framebuffer& out, const render_settings& settings,
+                                     const budget_settings& bs, budget_state& state, ray_stats* stats_out = nullptr) {
+    using clock = std::chrono::steady_clock;
+    auto ms_since = [](clock::time_point t) { return std::chrono::duration<double, std::milli>(clock::now() - t).count(); };
+    auto start = clock::now();
+    budget_report report;
+    std::mutex stats_mutex;
+    auto add_stats = [&](const ray_stats& s) {
+        if (!stats_out) return;
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats_out->add(s);
+    };
+    int full_w = out.width, full_h = out.height;
+
+    // Vazão ainda desconhecida: mede com 1 amostra num pixel a cada 16x16
+    if (state.samples_per_ms <= 0) {
+        auto t0 = clock::now();
+        int gw = std::max(1, full_w / 16), gh = std::max(1, full_h / 16);
+        std::atomic<long> traced{0};
+        parallel_items(gh, settings.threads, [&](int row) {
+            ray_stats stats;
+            shadow_cache shadows;
+            for (int g = 0; g < gw; g++)
+                sample_pixel(cam, world, lights, g * 16, row * 16, full_w, full_h, 1, settings.trace, stats, shadows);
+            traced += gw;
+            add_stats(stats);
+        });
+        state.observe(traced, ms_since(t0));
+    }
+
+    // 1. Escala: a passada de 1 spp deve caber em first_pass_share do que sobrou
+    double remaining = bs.budget_ms - ms_since(start);
+    double affordable = std::max(0.0, bs.first_pass_share * remaining * state.samples_per_ms);
+    report.scale = clamp(sqrt(affordable / (double(full_w) * full_h)), bs.min_scale, 1.0);
+    // Pelo menos 2x2: sample_pixel divide por (w-1) e (h-1)
+    int w = std::max(2, static_cast<int>(full_w * report.scale + 0.5));
+    int h = std::max(2, static_cast<int>(full_h * report.scale + 0.5));
+    report.width = w;
+    report.height = h;
+
+    framebuffer fb(w, h);
+    std::vector<double> lum2(static_cast<size_t>(w) * h, 0.0);
+    int bsz = bs.block_size;
+    int blocks_x = (w + bsz - 1) / bsz, blocks_y = (h + bsz - 1) / bsz;
+    int block_count = blocks_x * blocks_y;
+
+    // Prazo para começar um bloco: reserva a etapa final e o tempo de um bloco
+    // (sem medida ainda: ~20 ns por pixel de saída)
+    double reserve_ms = state.resolve_ms > 0 ? state.resolve_ms : 2e-5 * full_w * full_h;
+    double block_ms = bsz * bsz / std::max(state.samples_per_ms, 1e-6);
+    auto stop_at = start + std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double, std::milli>(bs.budget_ms - reserve_ms - block_ms));
+    std::atomic<bool> out_of_time{false};
+    std::atomic<long> traced{0};
+    auto render_start = clock::now();
+
+    // Uma amostra nos pixels do bloco b que passarem em want(i, j); false se o prazo chegou
+    auto run_pass = [&](const std::vector<int>& blocks, auto want) {
+        parallel_items(static_cast<int>(blocks.size()), settings.threads, [&](int n) {
+            if (out_of_time || clock::now() >= stop_at) {
+                out_of_time = true;
+                return;
+            }
+            int b = blocks[n];
+            int x0 = (b % blocks_x) * bsz, y0 = (b / blocks_x) * bsz;
+            ray_stats stats;
+            shadow_cache shadows;
+            long local = 0;
+            for (int j = y0; j < std::min(y0 + bsz, h); j++)
+                for (int i = x0; i < std::min(x0 + bsz, w); i++) {
+                    if (!want(i, j)) continue;
+                    size_t k = fb.index(i, j);
+                    aov_sample aov;
+                    fb.accum[k] += sample_pixel(cam, world, lights, i, j, w, h, 1, settings.trace, stats, shadows, &aov);
+                    fb.samples[k]++;
+                    lum2[k] += aov.luminance2;
+                    local++;
+                }
+            traced += local;
+            add_stats(stats);
+        });
+        report.passes++;
+        return !out_of_time;
+    };
+
+    // 2. Passada inicial de grossa para fina
+    std::vector<int> all_blocks(block_count);
+    for (int b = 0; b < block_count; b++) all_blocks[b] = b;
+    bool on_time = run_pass(all_blocks, [](int i, int j) { return i % 4 == 0 && j % 4 == 0; })
+                && run_pass(all_blocks, [](int i, int j) { return i % 2 == 0 && j % 2 == 0 && (i % 4 || j % 4); })
+                && run_pass(all_blocks, [](int i, int j) { return i % 2 || j % 2; });
+
+    // 3. Passadas por importância
+    auto mean_luminance = [&](int i, int j) {
+        size_t k = fb.index(i, j);
+        return fb.samples[k] > 0 ? luminance(fb.accum[k]) / fb.samples[k] : 0.0;
+    };
+    std::vector<double> importance(block_count);
+    std::vector<int> order(block_count);
+    while (on_time) {
+        int candidates = 0;
+        for (int b = 0; b < block_count; b++) {
+            int x0 = (b % blocks_x) * bsz, y0 = (b / blocks_x) * bsz;
+            double sum = 0.0;
+            bool open = false;
+            for (int j = y0; j < std::min(y0 + bsz, h); j++)
+                for (int i = x0; i < std::min(x0 + bsz, w); i++) {
+                    size_t k = fb.index(i, j);
+                    int n = fb.samples[k];
+                    if (n >= bs.max_spp) continue;
+                    open = true;
+                    double mean = mean_luminance(i, j);
+                    // Variância da média (cai com 1/n) + contraste com os vizinhos (bordas)
+                    double variance = std::max(0.0, lum2[k] / n - mean * mean) / n;
+                    double edge = 0.0;
+                    if (i + 1 < w) edge = std::max(edge, fabs(mean - mean_luminance(i + 1, j)));
+                    if (j + 1 < h) edge = std::max(edge, fabs(mean - mean_luminance(i, j + 1)));
+                    sum += variance + edge * edge / n;
+                }
+            importance[b] = open ? sum : -1.0;
+            order[b] = b;
+            if (open) candidates++;
+        }
+        if (candidates == 0) break;
+
+        int chosen = std::max(1, static_cast<int>(candidates * bs.refine_fraction));
+        std::partial_sort(order.begin(), order.begin() + chosen, order.end(),
+                          [&](int a, int b) { return importance[a] > importance[b]; });
+        order.resize(chosen);
+        on_time = run_pass(order, [&](int i, int j) { return fb.samples[fb.index(i, j)] < bs.max_spp; });
+        order.resize(block_count);
+    }
+
+    report.render_ms = ms_since(render_start);
+    report.samples = traced;
+    state.observe(traced, report.render_ms);
+
+    // 4. Buracos e ampliação
+    auto resolve_start = clock::now();
+    std::vector<color> image(static_cast<size_t>(w) * h);
+    std::vector<double> weight(image.size(), 0.0);
+    long covered = 0;
+    for (int j = 0; j < h; j++)
+        for (int i = 0; i < w; i++) {
+            size_t k = fb.index(i, j);
+            if (fb.samples[k] == 0) continue;
+            image[k] = fb.accum[k] / fb.samples[k];
+            weight[k] = 1.0;
+            covered++;
+        }
+    report.coverage = double(covered) / (double(w) * h);
+    if (covered > 0) pull_push_fill(image, weight, w, h);
+
+    out.clear();
+    for (int j = 0; j < full_h; j++) {
+        double y = clamp((j + 0.5) * h / full_h - 0.5, 0.0, h - 1.0);
+        int y0 = std::min(static_cast<int>(y), h - 1), y1 = std::min(y0 + 1, h - 1);
+        double fy = y - y0;
+        for (int i = 0; i < full_w; i++) {
+            double x = clamp((i + 0.5) * w / full_w - 0.5, 0.0, w - 1.0);
+            int x0 = std::min(static_cast<int>(x), w - 1), x1 = std::min(x0 + 1, w - 1);
+            double fx = x - x0;
+            auto at = [&](int a, int b) { return image[static_cast<size_t>(b) * w + a]; };
+            size_t k = out.index(i, j);
+            out.accum[k] = (1 - fy) * ((1 - fx) * at(x0, y0) + fx * at(x1, y0))
+                         + fy * ((1 - fx) * at(x0, y1) + fx * at(x1, y1));
+            out.samples[k] = 1;
+        }
+    }
+    report.resolve_ms = ms_since(resolve_start);
+    state.resolve_ms = state.resolve_ms > 0 ? 0.5 * state.resolve_ms + 0.5 * report.resolve_ms : report.resolve_ms;
+    report.elapsed_ms = ms_since(start);
+    return report;
+}
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "hittable.h"
+#include "hittable_list.h"
+
+#include <algorithm>
+#include <vector>
+
+// Hierarquia de Volumes Envolventes (BVH) em vetor plano.
+//
+// Pensada para cenas animadas: quando só as transformações das instâncias mudam,
+// update() refaz as caixas de baixo para cima (refit) em vez de reconstruir tudo.
+// O refit mantém a topologia, então a qualidade da árvore degrada se os objetos se
+// afastarem muito da posição do build. Medimos isso pelo custo SAH de cada subárvore
+// (normalizado pela área do próprio nó) e reconstruímos só as subárvores cujo custo
+// passou de rebuild_threshold vezes o custo que tinham no último build.
+class bvh : public hittable {
+    public:
+        struct node {
+            aabb box;
+            int left = -1, right = -1; // Filhos (-1 em folhas)
+            int first = 0, count = 0;  // Faixa em prim_index coberta por este nó
+            int axis = 0;              // Eixo usado na divisão (ordem de visita)
+            double cost = 0.0;         // Custo SAH atual da subárvore
+            double build_cost = 0.0;   // Custo SAH no último build desta subárvore
+
+            bool is_leaf() const { return left < 0; }
+        };
+
+        // Contadores da última chamada a update()
+        struct update_stats {
+            int refits = 0;           // Quantas vezes a árvore foi reajustada
+            int partial_rebuilds = 0; // Subárvores reconstruídas no último update
+            int prims_rebuilt = 0;    // Primitivas reordenadas nessas subárvores
+            double cost_ratio = 1.0;  // Custo atual / custo no build (raiz)
+        };
+
+        std::vector<shared_ptr<hittable>> objects;
+        std::vector<node> nodes;
+        std::vector<int> prim_index;
+        double rebuild_threshold;
+        int leaf_size = 2;
+        update_stats stats;
+
+        bvh(const hittable_list& list, double threshold = 1.3)
+            : bvh(list.objects, threshold) {}
+
+        bvh(const std::vector<shared_ptr<hittable>>& src_objects, double threshold = 1.3)
+            : objects(src_objects), rebuild_threshold(threshold) {
+            build();
+        }
+
+        // Build completo (top-down, divisão pela mediana do eixo mais longo)
+        void build() {
+            nodes.clear();
+            prim_index.resize(objects.size());
+            for (size_t i = 0; i < objects.size(); i++) prim_index[i] = static_cast<int>(i);
+            if (objects.empty()) return;
+
+            compute_prim_boxes();
+            nodes.reserve(2 * objects.size());
+            nodes.push_back(node());
+            build_node(0, 0, static_cast<int>(objects.size()));
+        }
+
+        // Só reajusta as caixas, sem mexer na topologia
+        void refit() {
+            if (nodes.empty()) return;
+            compute_prim_boxes();
+            refit_nodes();
+            stats.refits++;
+        }
+
+        // Refit + reconstrução parcial das subárvores que degradaram demais
+        void update() {
+            if (nodes.empty()) return;
+            refit();
+
+            stats.partial_rebuilds = 0;
+            stats.prims_rebuilt = 0;
+            rebuild_degraded(0);
+            if (stats.partial_rebuilds > 0) refit_nodes();
+
+            stats.cost_ratio = nodes[0].build_cost > 0 ? nodes[0].cost / nodes[0].build_cost : 1.0;
+        }
+
+        virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override {
+            if (nodes.empty()) return false;
+
+            vec3 d = r.direction();
+            vec3 inv_dir(1.0/d.x(), 1.0/d.y(), 1.0/d.z());
+
+            int stack[64];
+            int sp = 0;
+            stack[sp++] = 0;
+
+            hit_record temp_rec;
+            bool hit_anything = false;
+            auto closest_so_far = t_max;
+
+            while (sp > 0) {
+                const node& nd = nodes[stack[--sp]];
+                if (!nd.box.hit(r, inv_dir, t_min, closest_so_far)) continue;
+
+                if (nd.is_leaf()) {
+                    for (int i = nd.first; i < nd.first + nd.count; i++) {
+                        if (objects[prim_index[i]]->hit(r, t_min, closest_so_far, temp_rec)) {
+                            hit_anything = true;
+                            closest_so_far = temp_rec.t;
+                            rec = temp_rec;
+                            rec.object = objects[prim_index[i]].get();
+                        }
+                    }
+                } else {
+                    // Empilha o filho mais distante primeiro para visitar o mais próximo antes
+                    if (d[nd.axis] > 0) {
+                        stack[sp++] = nd.right;
+                        stack[sp++] = nd.left;
+                    } else {
+                        stack[sp++] = nd.left;
+                        stack[sp++] = nd.right;
+                    }
+                }
+            }
+
+            return hit_anything;
+        }
+
+        virtual bool bounding_box(aabb& output_box) const override {
+            if (nodes.empty()) return false;
+            output_box = nodes[0].box;
+            return true;
+        }
+
+    private:
+        std::vector<aabb> prim_boxes; // Caixas das primitivas (cache do último refit/build)
+
+        void compute_prim_boxes() {
+            prim_boxes.resize(objects.size());
+            for (size_t i = 0; i < objects.size(); i++) {
+                // Objetos sem caixa (ex: lista vazia) nunca são atingidos
+                if (!objects[i]->bounding_box(prim_boxes[i])) prim_boxes[i] = aabb();
+            }
+        }
+
+        // Monta a subárvore do nó n cobrindo prim_index[first .. first+count).
+        // Como a divisão é sempre pela mediana, a forma da árvore só depende de count:
+        // uma reconstrução parcial reaproveita exatamente os mesmos nós filhos.
+        void build_node(int n, int first, int count) {
+            nodes[n].first = first;
+            nodes[n].count = count;
+
+            if (count <= leaf_size) {
+                nodes[n].left = nodes[n].right = -1;
+                update_node(n);
+                nodes[n].build_cost = nodes[n].cost;
+                return;
+            }
+
+            aabb centroid_box;
+            for (int i = first; i < first + count; i++) {
+                point3 c = prim_boxes[prim_index[i]].centroid();
+                centroid_box = surrounding_box(centroid_box, aabb(c, c));
+            }
+            vec3 extent = centroid_box.maximum - centroid_box.minimum;
+            int axis = 0;
+            if (extent.y() > extent.x()) axis = 1;
+            if (extent.z() > extent[axis]) axis = 2;
+
+            int mid = first + count/2;
+            std::nth_element(prim_index.begin() + first, prim_index.begin() + mid,
+                             prim_index.begin() + first + count,
+                             [&](int a, int b) {
+                                 return prim_boxes[a].centroid()[axis] < prim_boxes[b].centroid()[axis];
+                             });
+
+            if (nodes[n].left < 0) {
+                nodes[n].left = static_cast<int>(nodes.size());
+                nodes.push_back(node());
+                nodes[n].right = static_cast<int>(nodes.size());
+                nodes.push_back(node());
+            }
+            nodes[n].axis = axis;
+
+            int left = nodes[n].left;
+            int right = nodes[n].right;
+            build_node(left, first, mid - first);
+            build_node(right, mid, first + count - mid);
+
+            update_node(n);
+            nodes[n].build_cost = nodes[n].cost;
+        }
+
+        // Recalcula caixa e custo do nó a partir dos filhos (ou das primitivas, se folha)
+        void update_node(int n) {
+            node& nd = nodes[n];
+            if (nd.is_leaf()) {
+                nd.box = aabb();
+                for (int i = nd.first; i < nd.first + nd.count; i++)
+                    nd.box = surrounding_box(nd.box, prim_boxes[prim_index[i]]);
+                nd.cost = nd.count;
+                return;
+            }
+
+            const node& l = nodes[nd.left];
+            const node& r = nodes[nd.right];
+            nd.box = surrounding_box(l.box, r.box);
+
+            double area = nd.box.surface_area();
+            if (area > 0 && std::isfinite(area))
+                nd.cost = 1.0 + (l.box.surface_area()*l.cost + r.box.surface_area()*r.cost) / area;
+            else
+                nd.cost = 1.0 + l.cost + r.cost;
+        }
+
+        // Filhos sempre têm índice maior que o pai, então basta percorrer de trás para frente
+        void refit_nodes() {
+            for (int n = static_cast<int>(nodes.size()) - 1; n >= 0; n--)
+                update_node(n);
+        }
+
+        void rebuild_degraded(int n) {
+            node& nd = nodes[n];
+            if (nd.is_leaf()) return;
+
+            if (nd.cost > rebuild_threshold * nd.build_cost) {
+                stats.partial_rebuilds++;
+                stats.prims_rebuilt += nd.count;
+                build_node(n, nd.first, nd.count);
+                return;
+            }
+
+            rebuild_degraded(nd.left);
+            rebuild_degraded(nodes[n].right);
+        }
+};
+
+#endif
@@ -63,6 +63,26 @@ class camera {
             );
         }
 
+        // Inverso de get_ray (sem lente): coordenadas (s, t) da tela cujo raio passa por 'p'.
+        // Retorna false se 'p' está atrás da câmera.
+        bool project(const point3& p, double& s, double& t) const {
+            point3 center = lower_left_corner + horizontal/2 + vertical/2;
+            vec3 forward = center - origin;
+            vec3 d = p - origin;
+            double along = dot(d, forward);
+            if (along <= 0) return false;
+            vec3 q = origin + (forward.length_squared() / along) * d - lower_left_corner;
+            s = dot(q, horizontal) / horizontal.length_squared();
+            t = dot(q, vertical) / vertical.length_squared();
+            return true;
+        }
+
+        // Ângulo (radianos) coberto por um pixel numa imagem com 'image_height' linhas
+        double pixel_spread(int image_height) const {
+            double focus_dist = (lower_left_corner + horizontal/2 + vertical/2 - origin).length();
+            return vertical.length() / (focus_dist * image_height);
+        }
+
     private:
         // Gera ponto aleatório num disco (para simular abertura de lente/defocus)
         static vec3 random_in_unit_disk() {
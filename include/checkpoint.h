@@ -0,0 +1,382 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "utils.h"
+#include "renderer.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// --- Framebuffer em Arquivo (checkpoint/retomada) ---
+//
+// Um render de 16k x 16k com muitas amostras leva horas e o framebuffer normal (doubles na memória,
+// imagem saindo no cout só no fim) perde tudo se o processo morrer. Aqui a imagem vive num arquivo
+// mapeado (mmap compartilhado):
+//   cabeçalho | por tile: amostras + slot válido | slot 0 | slot 1 (cada slot: pixels tile a tile, float RGB)
+// Cada tile guarda a MÉDIA das suas amostras. O tile novo é gravado no slot que o arquivo NÃO
+// aponta como válido; a tabela de tiles fica na memória e só vai para o arquivo no flush():
+//   1. msync dos pixels;  2. copia a tabela para o arquivo;  3. msync da tabela.
+// Assim a tabela no disco só aponta para slots que já estão no disco, mesmo com queda do sistema
+// (o writeback do kernel não tem ordem entre páginas), e o slot apontado nunca é reescrito antes
+// do flush seguinte. Ao reabrir, cada tile volta exatamente ao estado do último flush e refaz
+// as mesmas amostras (a semente depende do tile e das amostras feitas): retomar dá a mesma
+// imagem que renderizar sem parar. Perde-se só o trabalho desde o último flush.
+// Um --spp maior continua refinando os tiles já prontos.
+// Memória: o flush também solta as páginas do processo (MADV_DONTNEED; o arquivo fica no page
+// cache), então o residente é o que foi escrito desde o último flush, não a imagem inteira.
+// Sem mmap (Windows) open() falha e o render normal continua disponível.
+
+struct checkpoint_header {
+    char magic[4];        // "RTCK"
+    uint32_t version;
+    int32_t width, height;
+    int32_t tile_size;
+    int32_t tiles_x, tiles_y;
+    uint32_t reserved;
+    uint64_t data_offset; // Início dos pixels (alinhado a 4096)
+};
+
+struct checkpoint_tile_entry {
+    int32_t samples;  // Amostras da média guardada no slot válido
+    int32_t slot;     // 0 ou 1
+};
+
+struct checkpoint_settings {
+    double flush_seconds = 30.0;             // Intervalo máximo entre flushes
+    size_t flush_bytes = size_t(64) << 20;   // ... ou antes, quando tantos bytes de pixels foram escritos
+};
+
+class checkpoint_framebuffer {
+    public:
+        static const uint32_t file_version = 1;
+
+        int width = 0;
+        int height = 0;
+        int tile_size = 0;
+        int tiles_x = 0, tiles_y = 0;
+
+        checkpoint_framebuffer() {}
+        ~checkpoint_framebuffer() { close(); }
+        checkpoint_framebuffer(const checkpoint_framebuffer&) = delete;
+        checkpoint_framebuffer& operator=(const checkpoint_framebuffer&) = delete;
+
+        // Abre (ou cria) o arquivo para uma imagem w x h com tiles de 'tile'. 'resumed' diz se o
+        // arquivo já existia. Falha se o arquivo existente for de outra resolução ou tamanho de tile.
+        bool open(const char* path, int w, int h, int tile, bool& resumed) {
+            close();
+            resumed = false;
+            if (w <= 0 || h <= 0 || tile <= 0) return false;
+#ifndef _WIN32
+            fd = ::open(path, O_RDWR | O_CREAT, 0644);
+            if (fd < 0) return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0) return fail();
+
+            checkpoint_header expected = make_header(w, h, tile);
+            uint64_t tiles = static_cast<uint64_t>(expected.tiles_x) * expected.tiles_y;
+            uint64_t slot_bytes = static_cast<uint64_t>(tile) * tile * 3 * sizeof(float);
+            expected.data_offset = align(sizeof(checkpoint_header) + tiles * sizeof(checkpoint_tile_entry));
+            uint64_t total = expected.data_offset + 2 * slot_bytes * tiles;
+
+            if (st.st_size > 0) {
+                checkpoint_header found;
+                if (pread(fd, &found, sizeof(found), 0) != static_cast<ssize_t>(sizeof(found))
+                    || std::memcmp(found.magic, expected.magic, 4) != 0 || found.version != file_version
+                    || found.width != w || found.height != h || found.tile_size != tile
+                    || static_cast<uint64_t>(st.st_size) != total) return fail();
+                resumed = true;
+            } else {
+                // Arquivo esparso: blocos nunca escritos não ocupam disco e leem como zero
+                if (ftruncate(fd, static_cast<off_t>(total)) != 0
+                    || pwrite(fd, &expected, sizeof(expected), 0) != static_cast<ssize_t>(sizeof(expected))) return fail();
+            }
+
+            void* base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (base == MAP_FAILED) return fail();
+            mapping = static_cast<char*>(base);
+            mapping_length = total;
+            file_entries = reinterpret_cast<checkpoint_tile_entry*>(mapping + sizeof(checkpoint_header));
+            pixels = reinterpret_cast<float*>(mapping + expected.data_offset);
+            committed.assign(file_entries, file_entries + tiles);
+            current = committed;
+
+            width = w;
+            height = h;
+            tile_size = tile;
+            tiles_x = expected.tiles_x;
+            tiles_y = expected.tiles_y;
+            return true;
+#else
+            (void)path;
+            return false;
+#endif
+        }
+
+        void close() {
+#ifndef _WIN32
+            if (mapping) {
+                flush();
+                munmap(mapping, mapping_length);
+            }
+            if (fd >= 0) ::close(fd);
+#endif
+            mapping = nullptr;
+            mapping_length = 0;
+            file_entries = nullptr;
+            pixels = nullptr;
+            committed.clear();
+            current.clear();
+            fd = -1;
+        }
+
+        bool is_open() const { return mapping != nullptr; }
+        size_t file_bytes() const { return mapping_length; }
+        int tile_count() const { return tiles_x * tiles_y; }
+
+        int tile_index(int x0, int y0) const { return (y0 / tile_size) * tiles_x + x0 / tile_size; }
+
+        int tile_samples(int t) const {
+            std::lock_guard<std::mutex> lock(entries_mutex);
+            return current[t].samples;
+        }
+
+        long tiles_at(int target_spp) const {
+            std::lock_guard<std::mutex> lock(entries_mutex);
+            long n = 0;
+            for (const auto& e : current) if (e.samples >= target_spp) n++;
+            return n;
+        }
+
+        // Médias atuais do tile (linha a linha, tile_size por linha, como em pixel()), linear
+        const float* tile_means(int t) const {
+            std::lock_guard<std::mutex> lock(entries_mutex);
+            return slot_pixels(t, current[t].slot);
+        }
+
+        // Grava as médias novas no slot que o arquivo não aponta; vale no arquivo a partir do próximo flush
+        void store_tile(int t, const float* means, int samples) {
+            std::lock_guard<std::mutex> lock(entries_mutex);
+            int spare = 1 - committed[t].slot;
+            std::memcpy(slot_pixels(t, spare), means, tile_floats() * sizeof(float));
+            current[t].samples = samples;
+            current[t].slot = spare;
+        }
+
+        size_t tile_floats() const { return static_cast<size_t>(tile_size) * tile_size * 3; }
+
+        // Pixels para o disco, depois a tabela de tiles (nessa ordem); solta as páginas do processo
+        bool flush() {
+#ifndef _WIN32
+            if (!mapping) return false;
+            std::lock_guard<std::mutex> lock(entries_mutex);
+            size_t table_bytes = reinterpret_cast<char*>(pixels) - mapping;
+            if (msync(mapping + table_bytes, mapping_length - table_bytes, MS_SYNC) != 0) return false;
+            std::memcpy(file_entries, current.data(), current.size() * sizeof(checkpoint_tile_entry));
+            if (msync(mapping, table_bytes, MS_SYNC) != 0) return false;
+            committed = current;
+            madvise(mapping, mapping_length, MADV_DONTNEED);
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        // Mesmo formato de framebuffer::write_ppm, lendo uma faixa de tiles por vez e soltando-a em seguida
+        void write_ppm(std::ostream& out) const {
+            std::lock_guard<std::mutex> lock(entries_mutex);
+            out << "P3\n" << width << ' ' << height << "\n255\n";
+            for (int j = height-1; j >= 0; --j) {
+                for (int i = 0; i < width; ++i) {
+                    const float* p = pixel(i, j);
+                    out << static_cast<int>(256 * clamp(sqrt(p[0]), 0.0, 0.999)) << ' '
+                        << static_cast<int>(256 * clamp(sqrt(p[1]), 0.0, 0.999)) << ' '
+                        << static_cast<int>(256 * clamp(sqrt(p[2]), 0.0, 0.999)) << '\n';
+                }
+                if (j % tile_size == 0) release_strip(j / tile_size);
+            }
+        }
+
+    private:
+        int fd = -1;
+        char* mapping = nullptr;
+        size_t mapping_length = 0;
+        checkpoint_tile_entry* file_entries = nullptr;
+        float* pixels = nullptr;
+        std::vector<checkpoint_tile_entry> committed; // Cópia do que está no arquivo
+        std::vector<checkpoint_tile_entry> current;   // Com os tiles gravados desde o último flush
+        mutable std::mutex entries_mutex;
+
+        static uint64_t align(uint64_t offset) { return (offset + 4095) & ~uint64_t(4095); }
+
+        static checkpoint_header make_header(int w, int h, int tile) {
+            checkpoint_header hd;
+            std::memset(&hd, 0, sizeof(hd));
+            std::memcpy(hd.magic, "RTCK", 4);
+            hd.version = file_version;
+            hd.width = w;
+            hd.height = h;
+            hd.tile_size = tile;
+            hd.tiles_x = (w + tile - 1) / tile;
+            hd.tiles_y = (h + tile - 1) / tile;
+            return hd;
+        }
+
+        bool fail() {
+#ifndef _WIN32
+            ::close(fd);
+#endif
+            fd = -1;
+            return false;
+        }
+
+        // Cada slot é uma imagem inteira, tile a tile: gravar só num slot não suja páginas do outro
+        float* slot_pixels(int t, int slot) const {
+            return pixels + (static_cast<size_t>(slot) * tile_count() + t) * tile_floats();
+        }
+
+        // Sem trava: quem chama segura entries_mutex
+        const float* pixel(int i, int j) const {
+            int t = tile_index(i, j);
+            return slot_pixels(t, current[t].slot) + (static_cast<size_t>(j % tile_size) * tile_size + i % tile_size) * 3;
+        }
+
+        // Solta as páginas de uma faixa de tiles já lida (a faixa é contígua no arquivo)
+        void release_strip(int ty) const {
+#ifndef _WIN32
+            size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            for (int slot = 0; slot < 2; slot++) {
+                uintptr_t begin = reinterpret_cast<uintptr_t>(slot_pixels(ty * tiles_x, slot));
+                uintptr_t end = reinterpret_cast<uintptr_t>(slot_pixels((ty + 1) * tiles_x, slot));
+                begin = (begin + page - 1) / page * page; // Só páginas inteiras da faixa
+                end = end / page * page;
+                if (end > begin) madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+            }
+#else
+            (void)ty;
+#endif
+        }
+};
+
+struct checkpoint_report {
+    long tiles_rendered = 0;  // Tiles que receberam amostras nesta execução
+    long tiles_skipped = 0;   // Tiles que já estavam com 'target_spp' no arquivo
+    long samples = 0;
+    long flushes = 0;
+};
+
+// Completa cada tile do arquivo até 'target_spp' amostras (mesmo traço de render_region, com o
+// culling por tile), fazendo flush a cada 'flush_seconds' ou 'flush_bytes' e no fim.
+// O tile do arquivo tem que ter o tamanho de settings.tile_size.
+inline checkpoint_report render_checkpointed(const camera& cam, const hittable& world, const std::vector<PointLight>& lights,
+                                             checkpoint_framebuffer& cfb, int target_spp, const render_settings& settings,
+                                             const checkpoint_settings& cs, bool show_progress = false,
+                                             ray_stats* stats = nullptr) {
+    using clock = std::chrono::steady_clock;
+    checkpoint_report report;
+    std::atomic<long> rendered{0}, skipped{0}, traced{0}, flushes{0};
+    std::atomic<size_t> dirty_bytes{0};
+    std::atomic<int> tiles_done{0};
+    std::mutex flush_mutex, log_mutex;
+    auto start = clock::now();
+    std::atomic<double> last_flush{0.0}; // Segundos desde 'start'
+    int tiles_total = cfb.tile_count();
+    size_t tile_bytes = cfb.tile_floats() * sizeof(float);
+
+    pixel_region all{0, 0, cfb.width, cfb.height};
+    parallel_tiles(all, settings.tile_size, settings.threads, [&](const pixel_region& tile) {
+        int t = cfb.tile_index(tile.x0, tile.y0);
+        int done_spp = cfb.tile_samples(t);
+        int missing = target_spp - done_spp;
+        int done = ++tiles_done;
+        if (missing <= 0) {
+            skipped++;
+            return;
+        }
+
+        ray_stats tile_stats;
+        shadow_cache tile_shadows;
+        tile_candidates candidates(world);
+        const hittable* tile_world = &world;
+        if (settings.frustum_culling && candidates.build(cam, tile.x0, tile.y0, tile.x1, tile.y1, cfb.width, cfb.height)) {
+            tile_world = &candidates;
+            tile_stats.culled_tiles++;
+            tile_stats.tile_candidates += static_cast<long>(candidates.candidate_count());
+        }
+
+        // Amostras novas dependem só de (tile, amostras já feitas): retomar dá a mesma imagem que
+        // renderizar sem parar, e subir o --spp depois sorteia amostras diferentes das primeiras
+        seed_random(static_cast<uint32_t>(t) * 0x9E3779B1u ^ (static_cast<uint32_t>(done_spp) + 1) * 0x85EBCA77u);
+
+        // Nova média = (média antiga * amostras antigas + soma nova) / total
+        // (tile novo começa do zero sem ler o slot: ler também traz páginas para o processo)
+        std::vector<float> means(cfb.tile_floats(), 0.0f);
+        if (done_spp > 0) {
+            const float* stored = cfb.tile_means(t);
+            std::copy(stored, stored + cfb.tile_floats(), means.begin());
+        }
+        double inv_total = 1.0 / target_spp;
+        for (int j = tile.y1-1; j >= tile.y0; --j) {
+            for (int i = tile.x0; i < tile.x1; ++i) {
+                float* m = &means[(static_cast<size_t>(j - tile.y0) * cfb.tile_size + (i - tile.x0)) * 3];
+                color sum = sample_pixel(cam, *tile_world, lights, i, j, cfb.width, cfb.height, missing,
+                                         settings.trace, tile_stats, tile_shadows);
+                for (int c = 0; c < 3; c++)
+                    m[c] = static_cast<float>((double(m[c]) * done_spp + sum[c]) * inv_total);
+            }
+        }
+        cfb.store_tile(t, means.data(), target_spp);
+        rendered++;
+        traced += static_cast<long>(missing) * (tile.x1 - tile.x0) * (tile.y1 - tile.y0);
+
+        if (stats) {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            stats->add(tile_stats);
+        }
+
+        // Flush por quem passar do limite; os outros seguem traçando (e esperam só para gravar um tile)
+        size_t dirty = dirty_bytes += done_spp > 0 ? 2 * tile_bytes : tile_bytes; // Slot lido + slot gravado
+        double now = std::chrono::duration<double>(clock::now() - start).count();
+        if (dirty >= cs.flush_bytes || now - last_flush >= cs.flush_seconds) {
+            std::unique_lock<std::mutex> lock(flush_mutex, std::try_to_lock);
+            if (lock.owns_lock()) {
+                trace_scope scope("checkpoint.flush", "io");
+                dirty_bytes = 0;
+                cfb.flush();
+                last_flush = now;
+                flushes++;
+            }
+        }
+
+        if (show_progress && (done % 50 == 0 || done == tiles_total)) {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            std::cerr << "\rTiles restantes: " << tiles_total - done << ' ' << std::flush;
+        }
+    }, "checkpoint.tile");
+
+    {
+        trace_scope scope("checkpoint.flush", "io");
+        cfb.flush();
+        flushes++;
+    }
+    report.tiles_rendered = rendered;
+    report.tiles_skipped = skipped;
+    report.samples = traced;
+    report.flushes = flushes;
+    return report;
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "hittable.h"
 
+#include <algorithm>
+
 using namespace std;
 
 class cone : public hittable {
@@ -12,75 +14,151 @@ class cone : public hittable {
         shared_ptr<material> mat_ptr;
 
         // Cone com base em y=0 e ponta em y=height
-        cone(double h, double r, shared_ptr<material> m) 
+        cone(double h, double r, shared_ptr<material> m)
             : height(h), radius(r), mat_ptr(m) {}
 
+        // Mesma ideia do cilindro: o sólido é a faixa 0 <= y <= h intersectada com o interior do
+        // cone duplo x^2 + z^2 <= k^2 (h-y)^2. O interior do cone duplo ao longo do raio é um
+        // intervalo ou dois (raio mais inclinado que a parede atravessa as duas folhas); a folha de
+        // cima (y > h) cai fora da faixa. Sempre devolve a interseção mais próxima.
         virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override {
-            // Equação simplificada do cone: x^2 + z^2 = (r * (h-y)/h)^2
+            const vec3& o = r.orig;
+            const vec3& d = r.dir;
+
+            // 1. Faixa em y (a entrada por baixo é a base)
+            double inv_dy = 1.0 / d.y();
+            double t_base = -o.y() * inv_dy;
+            double t_apex = (height - o.y()) * inv_dy;
+            double slab_in = std::min(t_base, t_apex), slab_out = std::max(t_base, t_apex);
+            if (!(std::max(t_min, slab_in) <= std::min(t_max, slab_out))) return false;
+
+            // 2. Cone duplo: f(t) = a t^2 + 2 half_b t + c <= 0, com q = h - y na origem
             double k = radius / height;
             k = k*k;
-            
-            auto a = r.direction().x()*r.direction().x() + r.direction().z()*r.direction().z() - k*r.direction().y()*r.direction().y();
-            auto b = 2 * (r.origin().x()*r.direction().x() + r.origin().z()*r.direction().z() + k*r.direction().y()*(height - r.origin().y()));
-            auto c = r.origin().x()*r.origin().x() + r.origin().z()*r.origin().z() - k*(height - r.origin().y())*(height - r.origin().y());
-
-            auto delta = b*b - 4*a*c;
-            if (delta >= 0) {
-                auto sqrtd = sqrt(delta);
-                auto root = (-b - sqrtd) / (2*a);
-                if (check_cone(r, root, t_min, t_max, rec)) return true;
-                root = (-b + sqrtd) / (2*a);
-                if (check_cone(r, root, t_min, t_max, rec)) return true;
+            double q = height - o.y();
+            double a = d.x()*d.x() + d.z()*d.z() - k*d.y()*d.y();
+            double half_b = o.x()*d.x() + o.z()*d.z() + k*d.y()*q;
+            double c = o.x()*o.x() + o.z()*o.z() - k*q*q;
+
+            double side_in[2], side_out[2];
+            int intervals = 1;
+            side_in[0] = -infinity;
+            side_out[0] = infinity;
+            if (fabs(a) > 1e-12) {
+                double delta = half_b*half_b - a*c;
+                if (delta >= 0) {
+                    double sqrtd = sqrt(delta);
+                    double inv_a = 1.0 / a;
+                    double s0 = (-half_b - sqrtd) * inv_a, s1 = (-half_b + sqrtd) * inv_a;
+                    if (s0 > s1) std::swap(s0, s1);
+                    if (a > 0) {
+                        side_in[0] = s0;
+                        side_out[0] = s1;
+                    } else {
+                        side_out[0] = s0;
+                        side_in[1] = s1;
+                        side_out[1] = infinity;
+                        intervals = 2;
+                    }
+                } else if (a > 0) {
+                    return false; // Passa longe do cone
+                }
+            } else if (fabs(half_b) > 1e-12) {
+                // Paralelo à parede: f é linear
+                double root = -c / (2*half_b);
+                if (half_b > 0) side_out[0] = root;
+                else side_in[0] = root;
+            } else if (c > 0) {
+                return false;
+            }
+
+            // 3. Sólido = faixa ∩ cada intervalo; fica o extremo mais próximo depois de t_min
+            double best = infinity;
+            bool best_side = false;
+            for (int i = 0; i < intervals; i++) {
+                double enter = std::max(slab_in, side_in[i]), exit = std::min(slab_out, side_out[i]);
+                if (enter > exit) continue;
+                bool inside = enter < t_min;
+                double t = inside ? exit : enter;
+                bool on_side = inside ? side_out[i] < slab_out : side_in[i] > slab_in;
+                if (t >= t_min && t <= t_max && t < best) {
+                    best = t;
+                    best_side = on_side;
+                }
             }
-            
-            // Checa a base (disco em y=0)
-            if (check_base(r, t_min, t_max, rec)) return true;
+            if (best == infinity) return false;
 
-            return false;
+            set_hit(r, best, best_side, rec);
+            return true;
         }
 
-    private:
-        bool check_cone(const ray& r, double t, double t_min, double t_max, hit_record& rec) const {
-            if (t < t_min || t > t_max) return false;
-            auto y = r.origin().y() + t * r.direction().y();
-            if (y < 0 || y > height) return false; // Corta nas alturas 0 e h
+        // Referência lenta: as duas raízes da parede (cortadas em 0 <= y <= h) e a base testadas
+        // separadamente, fica a menor t. Usada só para validar hit().
+        bool hit_reference(const ray& r, double t_min, double t_max, hit_record& rec) const {
+            double best = infinity;
+            bool best_side = false;
+            auto consider = [&](double t, bool side) {
+                if (t >= t_min && t <= t_max && t < best) {
+                    best = t;
+                    best_side = side;
+                }
+            };
+            auto consider_wall = [&](double t) {
+                double y = r.orig.y() + t * r.dir.y();
+                if (y >= 0 && y <= height) consider(t, true);
+            };
 
-            rec.t = t;
-            rec.p = r.at(t);
-            
-            // Normal do cone
-            double r_at_y = radius * (height - y) / height;
-            vec3 outward_normal = vec3(rec.p.x(), k_slope_normal(), rec.p.z());
-            outward_normal = unit_vector(outward_normal);
-            
-            rec.set_face_normal(r, outward_normal);
-            rec.mat_ptr = mat_ptr;
-            rec.u = rec.p.x() / (2*radius) + 0.5;
-            rec.v = y / height;
+            double k = radius / height;
+            k = k*k;
+            double q = height - r.orig.y();
+            double a = r.dir.x()*r.dir.x() + r.dir.z()*r.dir.z() - k*r.dir.y()*r.dir.y();
+            double b = 2 * (r.orig.x()*r.dir.x() + r.orig.z()*r.dir.z() + k*r.dir.y()*q);
+            double c = r.orig.x()*r.orig.x() + r.orig.z()*r.orig.z() - k*q*q;
+            if (fabs(a) > 1e-12) {
+                double delta = b*b - 4*a*c;
+                if (delta >= 0) {
+                    consider_wall((-b - sqrt(delta)) / (2*a));
+                    consider_wall((-b + sqrt(delta)) / (2*a));
+                }
+            } else if (fabs(b) > 1e-12) {
+                consider_wall(-c / b);
+            }
+
+            double t = -r.orig.y() / r.dir.y();
+            double x = r.orig.x() + t * r.dir.x();
+            double z = r.orig.z() + t * r.dir.z();
+            if (x*x + z*z <= radius*radius) consider(t, false);
+
+            if (best == infinity) return false;
+            set_hit(r, best, best_side, rec);
             return true;
         }
-        
-        // Helper para a inclinação da normal
-        double k_slope_normal() const {
-            return (radius/height); 
+
+        virtual bool bounding_box(aabb& output_box) const override {
+            output_box = aabb(point3(-radius, 0, -radius), point3(radius, height, radius));
+            return true;
         }
 
-        bool check_base(const ray& r, double t_min, double t_max, hit_record& rec) const {
-            auto t = (0 - r.origin().y()) / r.direction().y();
-            if (t < t_min || t > t_max) return false;
-            
-            auto x = r.origin().x() + t * r.direction().x();
-            auto z = r.origin().z() + t * r.direction().z();
-            
-            if (x*x + z*z <= radius*radius) {
-                rec.t = t;
-                rec.p = r.at(t);
-                rec.set_face_normal(r, vec3(0, -1, 0)); // Aponta para baixo
-                rec.mat_ptr = mat_ptr;
-                return true;
+    private:
+        void set_hit(const ray& r, double t, bool on_side, hit_record& rec) const {
+            rec.t = t;
+            rec.p = r.at(t);
+            rec.mat_ptr = mat_ptr.get();
+            if (on_side) {
+                // Gradiente de x^2 + z^2 - k^2 (h-y)^2: (x, k^2 (h-y), z)
+                double k = radius / height;
+                vec3 outward_normal(rec.p.x(), k*k*(height - rec.p.y()), rec.p.z());
+                // Na ponta o gradiente se anula: usa o eixo
+                outward_normal = outward_normal.length_squared() > 1e-24 ? unit_vector(outward_normal) : vec3(0, 1, 0);
+                rec.set_face_normal(r, outward_normal);
+                rec.u = rec.p.x() / (2*radius) + 0.5;
+                rec.v = rec.p.y() / height;
+            } else {
+                rec.set_face_normal(r, vec3(0, -1, 0)); // Base aponta para baixo
+                rec.u = (rec.p.x()/radius + 1)/2;
+                rec.v = (rec.p.z()/radius + 1)/2;
             }
-            return false;
         }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -2,6 +2,7 @@
 #define CYLINDER_H
 
 #include "hittable.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
@@ -13,76 +14,112 @@ class cylinder : public hittable {
         shared_ptr<material> mat_ptr;
 
         // Cilindro centrado na origem (0,0,0) estendendo de -height/2 a +height/2 no eixo Y
-        cylinder(double h, double r, shared_ptr<material> m) 
+        cylinder(double h, double r, shared_ptr<material> m)
             : height(h), radius(r), mat_ptr(m) {}
 
+        // O sólido é a interseção de dois intervalos do raio:
+        //   - faixa |y| <= h/2 (entrada e saída são exatamente as tampas);
+        //   - cilindro infinito x^2 + z^2 <= r^2 (as duas raízes da lateral).
+        // A entrada no sólido é o maior dos inícios e a saída o menor dos fins; a superfície atingida
+        // é a do intervalo que definiu o extremo. Sempre devolve a interseção mais próxima.
         virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override {
-            // A matemática aqui resolve x^2 + z^2 = r^2
-            bool hit_side = false;
-            
-            // 1. Teste da Superfície Lateral
-            auto a = r.direction().x() * r.direction().x() + r.direction().z() * r.direction().z();
-            auto b = 2 * (r.origin().x() * r.direction().x() + r.origin().z() * r.direction().z());
-            auto c = r.origin().x() * r.origin().x() + r.origin().z() * r.origin().z() - radius*radius;
-
-            if (a > 1e-8) { // Se não for paralelo ao eixo Y
-                auto delta = b*b - 4*a*c;
-                if (delta >= 0) {
-                    auto sqrtd = sqrt(delta);
-                    auto root = (-b - sqrtd) / (2*a);
-                    if (check_height(r, root, t_min, t_max, rec)) return true;
-                    root = (-b + sqrtd) / (2*a);
-                    if (check_height(r, root, t_min, t_max, rec)) return true;
+            const vec3& o = r.orig;
+            const vec3& d = r.dir;
+            double half = height / 2;
+
+            // 1. Faixa em y: descarta o raio antes da quadrática (d.y = 0 dá +-inf, que funciona)
+            double inv_dy = 1.0 / d.y();
+            double t_bottom = (-half - o.y()) * inv_dy;
+            double t_top = (half - o.y()) * inv_dy;
+            double slab_in = std::min(t_bottom, t_top), slab_out = std::max(t_bottom, t_top);
+            if (!(std::max(t_min, slab_in) <= std::min(t_max, slab_out))) return false;
+
+            // 2. Cilindro infinito (b pela metade)
+            double a = d.x()*d.x() + d.z()*d.z();
+            double half_b = o.x()*d.x() + o.z()*d.z();
+            double c = o.x()*o.x() + o.z()*o.z() - radius*radius;
+            double side_in = -infinity, side_out = infinity;
+            if (a > 1e-12) {
+                double delta = half_b*half_b - a*c;
+                if (delta < 0) return false;
+                double sqrtd = sqrt(delta);
+                double inv_a = 1.0 / a;
+                side_in = (-half_b - sqrtd) * inv_a;
+                side_out = (-half_b + sqrtd) * inv_a;
+            } else if (c > 0) {
+                return false; // Paralelo ao eixo Y, fora do raio
+            }
+
+            // 3. Sólido = faixa ∩ cilindro infinito
+            double enter = std::max(slab_in, side_in), exit = std::min(slab_out, side_out);
+            if (enter > exit) return false;
+            bool inside = enter < t_min; // Raio começa dentro (refração): vale a saída
+            double t = inside ? exit : enter;
+            if (t < t_min || t > t_max) return false;
+            bool on_side = inside ? side_out < slab_out : side_in > slab_in;
+
+            set_hit(r, t, on_side, rec);
+            return true;
+        }
+
+        // Referência lenta: testa a lateral (duas raízes) e as duas tampas separadamente e fica
+        // com a menor t. Usada só para validar hit().
+        bool hit_reference(const ray& r, double t_min, double t_max, hit_record& rec) const {
+            double best = infinity;
+            bool best_side = false;
+            auto consider = [&](double t, bool side) {
+                if (t >= t_min && t <= t_max && t < best) {
+                    best = t;
+                    best_side = side;
+                }
+            };
+
+            double a = r.dir.x()*r.dir.x() + r.dir.z()*r.dir.z();
+            double b = 2 * (r.orig.x()*r.dir.x() + r.orig.z()*r.dir.z());
+            double c = r.orig.x()*r.orig.x() + r.orig.z()*r.orig.z() - radius*radius;
+            if (a > 1e-12 && b*b - 4*a*c >= 0) {
+                double sqrtd = sqrt(b*b - 4*a*c);
+                for (double t : {(-b - sqrtd) / (2*a), (-b + sqrtd) / (2*a)}) {
+                    double y = r.orig.y() + t * r.dir.y();
+                    if (fabs(y) <= height/2) consider(t, true);
                 }
             }
+            for (double y_plane : {height/2, -height/2}) {
+                double t = (y_plane - r.orig.y()) / r.dir.y();
+                double x = r.orig.x() + t * r.dir.x();
+                double z = r.orig.z() + t * r.dir.z();
+                if (x*x + z*z <= radius*radius) consider(t, false);
+            }
 
-            // 2. Teste das Tampas (Círculos em y = +h/2 e y = -h/2)
-            if (check_cap(r, height/2, t_min, t_max, true, rec)) return true;
-            if (check_cap(r, -height/2, t_min, t_max, false, rec)) return true;
+            if (best == infinity) return false;
+            set_hit(r, best, best_side, rec);
+            return true;
+        }
 
-            return false;
+        virtual bool bounding_box(aabb& output_box) const override {
+            output_box = aabb(point3(-radius, -height/2, -radius), point3(radius, height/2, radius));
+            return true;
         }
 
     private:
-        // Verifica se a interseção lateral está dentro da altura válida
-        bool check_height(const ray& r, double t, double t_min, double t_max, hit_record& rec) const {
-            if (t < t_min || t > t_max) return false;
-            auto y = r.origin().y() + t * r.direction().y();
-            if (y < -height/2 || y > height/2) return false;
-
+        void set_hit(const ray& r, double t, bool on_side, hit_record& rec) const {
             rec.t = t;
             rec.p = r.at(t);
-            vec3 outward_normal = vec3(rec.p.x(), 0, rec.p.z()) / radius; // Normal aponta para fora no XZ
-            rec.set_face_normal(r, outward_normal);
-            rec.mat_ptr = mat_ptr;
-            
-            // UV mapping cilíndrico
-            auto phi = atan2(rec.p.z(), rec.p.x()); 
-            rec.u = 1 - (phi + M_PI) / (2*M_PI);
-            rec.v = (y + height/2) / height;
-            
-            return true;
-        }
+            rec.mat_ptr = mat_ptr.get();
+            if (on_side) {
+                vec3 outward_normal = vec3(rec.p.x(), 0, rec.p.z()) / radius; // Normal aponta para fora no XZ
+                rec.set_face_normal(r, outward_normal);
 
-        // Verifica interseção com as tampas planas
-        bool check_cap(const ray& r, double y_plane, double t_min, double t_max, bool is_top, hit_record& rec) const {
-            auto t = (y_plane - r.origin().y()) / r.direction().y();
-            if (t < t_min || t > t_max) return false;
-            
-            auto x = r.origin().x() + t * r.direction().x();
-            auto z = r.origin().z() + t * r.direction().z();
-            
-            if (x*x + z*z <= radius*radius) {
-                rec.t = t;
-                rec.p = r.at(t);
-                rec.set_face_normal(r, vec3(0, is_top ? 1 : -1, 0));
-                rec.mat_ptr = mat_ptr;
-                rec.u = (x/radius + 1)/2; // Mapeamento planar simples
-                rec.v = (z/radius + 1)/2;
-                return true;
+                // UV mapping cilíndrico
+                auto phi = atan2(rec.p.z(), rec.p.x());
+                rec.u = 1 - (phi + M_PI) / (2*M_PI);
+                rec.v = (rec.p.y() + height/2) / height;
+            } else {
+                rec.set_face_normal(r, vec3(0, rec.p.y() > 0 ? 1 : -1, 0));
+                rec.u = (rec.p.x()/radius + 1)/2; // Mapeamento planar simples
+                rec.v = (rec.p.z()/radius + 1)/2;
             }
-            return false;
         }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,361 @@
+#ifndef DENOISE_H
+#define DENOISE_H
+
+#include "utils.h"
+#include "framebuffer.h"
+#include "renderer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DENOISE_SSE2 1
+#endif
+
+// --- Denoiser À-Trous (Edge-Avoiding) ---
+//
+// Filtro wavelet "à trous" (Dammertz et al. 2010): núcleo B3 5x5 aplicado várias vezes com
+// espaçamento 1, 2, 4, 8... entre as amostras, o que cobre um raio grande com só 25 leituras
+// por pixel e passe. Cada vizinho pesa menos quando difere do pixel central em:
+//   - luminância, medida em desvios-padrão do ruído do pixel (como no SVGF): pixels ruidosos
+//     (xadrez distante, reflexos com roleta russa) são bem filtrados, pixels estáveis não borram;
+//   - normal e profundidade (AOVs do hit primário, sem ruído: preservam as bordas geométricas);
+//   - albedo, com peso pequeno (evita misturar materiais diferentes na mesma superfície).
+// A variância de cada pixel vem do segundo momento da luminância e é filtrada junto (pesos ao
+// quadrado), então cai a cada passe e o filtro vai ficando mais conservador.
+//
+// Os dados ficam em planos float separados (SoA) e o laço interno percorre uma linha contínua
+// sem desvios, com um único exp aproximado por vizinho. Em x86 (SSE2, presente em todo x86-64)
+// o laço processa 4 pixels por vez com intrínsecos; nos demais alvos fica a versão escalar.
+// As linhas são divididas em tiles entre as threads (parallel_tiles).
+
+struct denoise_settings {
+    int iterations = 5;           // Passes (raio efetivo ~ 2 * 2^iterations pixels)
+    float sigma_luminance = 4.0f; // Tolerância de luminância, em desvios-padrão
+    float sigma_normal = 32.0f;   // Peso ~ exp(-sigma_normal * (1 - n_p . n_q))
+    float sigma_depth = 0.02f;    // Tolerância relativa de profundidade por pixel de distância
+    float sigma_albedo = 0.5f;
+    // Filtra só a iluminação (cor / albedo) e multiplica o albedo de volta. Só compensa quando
+    // os AOVs têm mais amostras que a cor (render_aov_region): senão o albedo traz de volta o
+    // mesmo ruído de textura que o filtro tirou.
+    bool demodulate = false;
+    int threads = 0;
+    int tile_size = 64;
+};
+
+namespace denoise_detail {
+
+// exp(x) aproximado para x <= 0 (erro relativo < 1e-4): 2^x com polinômio na parte fracionária
+// e o expoente montado direto nos bits do float.
+inline float fast_exp(float x) {
+    x = std::max(x, -80.0f);
+    float y = x * 1.44269504f;
+    int i = static_cast<int>(y + 128.0f) - 128; // floor (y + 128 > 0, truncar = arredondar para baixo)
+    float f = y - static_cast<float>(i);
+    float p = 1.0f + f*(0.693147f + f*(0.240227f + f*(0.0555041f + f*0.00961812f)));
+    int32_t bits = (i + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+#ifdef DENOISE_SSE2
+// Mesma conta de fast_exp, 4 valores por vez
+inline __m128 fast_exp4(__m128 x) {
+    x = _mm_max_ps(x, _mm_set1_ps(-80.0f));
+    __m128 y = _mm_mul_ps(x, _mm_set1_ps(1.44269504f));
+    __m128i i = _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(y, _mm_set1_ps(128.0f))), _mm_set1_epi32(128));
+    __m128 f = _mm_sub_ps(y, _mm_cvtepi32_ps(i));
+    __m128 p = _mm_add_ps(_mm_set1_ps(0.0555041f), _mm_mul_ps(f, _mm_set1_ps(0.00961812f)));
+    p = _mm_add_ps(_mm_set1_ps(0.240227f), _mm_mul_ps(f, p));
+    p = _mm_add_ps(_mm_set1_ps(0.693147f), _mm_mul_ps(f, p));
+    p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(f, p));
+    __m128i bits = _mm_slli_epi32(_mm_add_epi32(i, _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(p, _mm_castsi128_ps(bits));
+}
+#endif
+
+// Imagem sendo filtrada (linha j = 0 embaixo, como no framebuffer)
+struct planes {
+    int width = 0;
+    int height = 0;
+    std::vector<float> r, g, b;
+    std::vector<float> var; // Variância da luminância da média do pixel
+
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        size_t n = static_cast<size_t>(w) * h;
+        r.assign(n, 0.0f);
+        g.assign(n, 0.0f);
+        b.assign(n, 0.0f);
+        var.assign(n, 0.0f);
+    }
+};
+
+// Guias (fixas durante todos os passes, menos inv_lum_scale)
+struct guides {
+    std::vector<float> nx, ny, nz;
+    std::vector<float> ar, ag, ab;       // Albedo
+    std::vector<float> depth;
+    std::vector<float> inv_depth_scale;  // 1 / (sigma_depth * profundidade)
+    std::vector<float> inv_lum_scale;    // 1 / (sigma_luminance * desvio-padrão), refeito a cada passe
+};
+
+// Acumuladores de um trecho de linha
+struct row_accum {
+    float* r;
+    float* g;
+    float* b;
+    float* w;
+    float* v; // Soma de w^2 * variância
+};
+
+// Acumula os vizinhos q = x + shift (x em [x0, x1)) da linha 'qrow' nos acumuladores dos pixels
+// [x0, x1) da linha central 'prow'. 'hk' é o peso do núcleo B3; 'inv_dist' = 1 / distância do tap.
+inline void accumulate_span(int x0, int x1, int shift, float hk, float inv_dist, size_t prow, size_t qrow,
+                            const planes& in, const guides& gd, const denoise_settings& ds, const row_accum& acc) {
+    const float* cr = in.r.data();
+    const float* cg = in.g.data();
+    const float* cb = in.b.data();
+    const float* cv = in.var.data();
+    const float* nx = gd.nx.data();
+    const float* ny = gd.ny.data();
+    const float* nz = gd.nz.data();
+    const float* ar = gd.ar.data();
+    const float* ag = gd.ag.data();
+    const float* ab = gd.ab.data();
+    const float* z = gd.depth.data();
+    const float* zs = gd.inv_depth_scale.data();
+    const float* ls = gd.inv_lum_scale.data();
+    float* __restrict acc_r = acc.r;
+    float* __restrict acc_g = acc.g;
+    float* __restrict acc_b = acc.b;
+    float* __restrict acc_w = acc.w;
+    float* __restrict acc_v = acc.v;
+    float inv_sigma_albedo2 = 1.0f / (ds.sigma_albedo * ds.sigma_albedo);
+    int x = x0;
+
+#ifdef DENOISE_SSE2
+    const __m128 v_hk = _mm_set1_ps(hk);
+    const __m128 v_inv_dist = _mm_set1_ps(inv_dist);
+    const __m128 v_sn = _mm_set1_ps(ds.sigma_normal);
+    const __m128 v_sa = _mm_set1_ps(inv_sigma_albedo2);
+    const __m128 v_one = _mm_set1_ps(1.0f);
+    const __m128 v_abs = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 v_lr = _mm_set1_ps(0.2126f), v_lg = _mm_set1_ps(0.7152f), v_lb = _mm_set1_ps(0.0722f);
+    auto load = [](const float* a, size_t k) { return _mm_loadu_ps(a + k); };
+    auto sq = [](__m128 d) { return _mm_mul_ps(d, d); };
+
+    for (; x + 4 <= x1; x += 4) {
+        size_t p = prow + x;
+        size_t q = qrow + x + shift;
+
+        __m128 qr = load(cr, q), qg = load(cg, q), qb = load(cb, q);
+        __m128 dl = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v_lr, _mm_sub_ps(load(cr, p), qr)),
+                                          _mm_mul_ps(v_lg, _mm_sub_ps(load(cg, p), qg))),
+                               _mm_mul_ps(v_lb, _mm_sub_ps(load(cb, p), qb)));
+        dl = _mm_and_ps(dl, v_abs);
+
+        __m128 ndot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(load(nx, p), load(nx, q)),
+                                            _mm_mul_ps(load(ny, p), load(ny, q))),
+                                 _mm_mul_ps(load(nz, p), load(nz, q)));
+
+        __m128 dz = _mm_and_ps(_mm_sub_ps(load(z, p), load(z, q)), v_abs);
+
+        __m128 da = _mm_add_ps(_mm_add_ps(sq(_mm_sub_ps(load(ar, p), load(ar, q))),
+                                          sq(_mm_sub_ps(load(ag, p), load(ag, q)))),
+                               sq(_mm_sub_ps(load(ab, p), load(ab, q))));
+
+        __m128 e = _mm_mul_ps(dl, load(ls, p));
+        e = _mm_add_ps(e, _mm_mul_ps(v_sn, _mm_sub_ps(v_one, ndot)));
+        e = _mm_add_ps(e, _mm_mul_ps(_mm_mul_ps(dz, load(zs, p)), v_inv_dist));
+        e = _mm_add_ps(e, _mm_mul_ps(da, v_sa));
+        __m128 w = _mm_mul_ps(v_hk, fast_exp4(_mm_sub_ps(_mm_setzero_ps(), e)));
+
+        size_t k = x - x0;
+        _mm_storeu_ps(acc_r + k, _mm_add_ps(load(acc_r, k), _mm_mul_ps(w, qr)));
+        _mm_storeu_ps(acc_g + k, _mm_add_ps(load(acc_g, k), _mm_mul_ps(w, qg)));
+        _mm_storeu_ps(acc_b + k, _mm_add_ps(load(acc_b, k), _mm_mul_ps(w, qb)));
+        _mm_storeu_ps(acc_w + k, _mm_add_ps(load(acc_w, k), w));
+        _mm_storeu_ps(acc_v + k, _mm_add_ps(load(acc_v, k), _mm_mul_ps(sq(w), load(cv, q))));
+    }
+#endif
+
+    for (; x < x1; x++) {
+        size_t p = prow + x;
+        size_t q = qrow + x + shift;
+
+        float dl = std::fabs(0.2126f*(cr[p] - cr[q]) + 0.7152f*(cg[p] - cg[q]) + 0.0722f*(cb[p] - cb[q]));
+        float ndot = nx[p]*nx[q] + ny[p]*ny[q] + nz[p]*nz[q];
+        float dz = std::fabs(z[p] - z[q]);
+        float er = ar[p] - ar[q], eg = ag[p] - ag[q], eb = ab[p] - ab[q];
+        float da = er*er + eg*eg + eb*eb;
+
+        float e = dl * ls[p]
+                + ds.sigma_normal * (1.0f - ndot)
+                + dz * zs[p] * inv_dist
+                + da * inv_sigma_albedo2;
+        float w = hk * fast_exp(-e);
+
+        size_t k = x - x0;
+        acc_r[k] += w * cr[q];
+        acc_g[k] += w * cg[q];
+        acc_b[k] += w * cb[q];
+        acc_w[k] += w;
+        acc_v[k] += w * w * cv[q];
+    }
+}
+
+// Desvio-padrão de cada pixel (variância suavizada num 3x3, como no SVGF) -> escala da luminância
+inline void luminance_scale_tile(const pixel_region& tile, const planes& in, guides& gd, const denoise_settings& ds) {
+    static const float k3[3] = {0.25f, 0.5f, 0.25f};
+    int w = in.width, h = in.height;
+    for (int y = tile.y0; y < tile.y1; y++) {
+        for (int x = tile.x0; x < tile.x1; x++) {
+            float v = 0.0f;
+            for (int dy = -1; dy <= 1; dy++) {
+                int qy = std::min(std::max(y + dy, 0), h - 1);
+                for (int dx = -1; dx <= 1; dx++) {
+                    int qx = std::min(std::max(x + dx, 0), w - 1);
+                    v += k3[dy + 1] * k3[dx + 1] * in.var[static_cast<size_t>(qy) * w + qx];
+                }
+            }
+            gd.inv_lum_scale[static_cast<size_t>(y) * w + x] = 1.0f / (ds.sigma_luminance * sqrtf(v) + 1e-4f);
+        }
+    }
+}
+
+// Um passe à-trous com espaçamento 'step' sobre o tile
+inline void atrous_tile(const pixel_region& tile, int step, const planes& in, planes& out,
+                        const guides& gd, const denoise_settings& ds) {
+    static const float h[5] = {1.0f/16, 1.0f/4, 3.0f/8, 1.0f/4, 1.0f/16};
+    int w = in.width, hgt = in.height;
+    int span = tile.x1 - tile.x0;
+    std::vector<float> storage(5 * static_cast<size_t>(span));
+    row_accum acc{storage.data(), storage.data() + span, storage.data() + 2*span,
+                  storage.data() + 3*span, storage.data() + 4*span};
+    auto shifted = [&](int x) {
+        int k = x - tile.x0;
+        return row_accum{acc.r + k, acc.g + k, acc.b + k, acc.w + k, acc.v + k};
+    };
+
+    for (int y = tile.y0; y < tile.y1; y++) {
+        std::fill(storage.begin(), storage.end(), 0.0f);
+        size_t prow = static_cast<size_t>(y) * w;
+
+        for (int ky = -2; ky <= 2; ky++) {
+            int qy = std::min(std::max(y + ky*step, 0), hgt - 1);
+            size_t qrow = static_cast<size_t>(qy) * w;
+
+            for (int kx = -2; kx <= 2; kx++) {
+                int offset = kx * step;
+                float hk = h[ky + 2] * h[kx + 2];
+                float dist = step * sqrtf(float(kx*kx + ky*ky));
+                float inv_dist = dist > 0.0f ? 1.0f / dist : 0.0f;
+
+                // Trecho em que x + offset cai dentro da imagem: leituras contínuas
+                int lo = std::max(tile.x0, -offset);
+                int hi = std::min(tile.x1, w - offset);
+                if (lo < hi) accumulate_span(lo, hi, offset, hk, inv_dist, prow, qrow, in, gd, ds, shifted(lo));
+                // Bordas: vizinho preso à borda, um pixel por vez
+                for (int x = tile.x0; x < tile.x1; x++) {
+                    if (x >= lo && x < hi) continue;
+                    int qx = std::min(std::max(x + offset, 0), w - 1);
+                    accumulate_span(x, x + 1, qx - x, hk, inv_dist, prow, qrow, in, gd, ds, shifted(x));
+                }
+            }
+        }
+
+        // O tap central tem peso > 0, então acc.w nunca é zero
+        for (int x = tile.x0; x < tile.x1; x++) {
+            int k = x - tile.x0;
+            float inv = 1.0f / acc.w[k];
+            out.r[prow + x] = acc.r[k] * inv;
+            out.g[prow + x] = acc.g[k] * inv;
+            out.b[prow + x] = acc.b[k] * inv;
+            out.var[prow + x] = acc.v[k] * inv * inv;
+        }
+    }
+}
+
+} // namespace denoise_detail
+
+// Filtra o framebuffer no lugar (precisa dos AOVs: fb.enable_aovs() antes do render).
+// Depois disso 'accum' guarda a imagem filtrada; acumular mais amostras nela não faz sentido.
+// Retorna false se o framebuffer não tem AOVs.
+inline bool denoise(framebuffer& fb, const denoise_settings& ds = denoise_settings()) {
+    using namespace denoise_detail;
+    if (!fb.has_aovs() || fb.width == 0 || fb.height == 0) return false;
+
+    const double albedo_eps = 0.02;
+    int w = fb.width, h = fb.height;
+    size_t n = static_cast<size_t>(w) * h;
+
+    guides gd;
+    for (auto* v : {&gd.nx, &gd.ny, &gd.nz, &gd.ar, &gd.ag, &gd.ab, &gd.depth, &gd.inv_depth_scale, &gd.inv_lum_scale})
+        v->assign(n, 0.0f);
+    planes a, b;
+    a.resize(w, h);
+    b.resize(w, h);
+
+    // Médias por pixel (com demodulate, a cor é dividida pelo albedo)
+    auto divisor = [&](const color& alb) {
+        if (!ds.demodulate) return color(1, 1, 1);
+        return color(std::max(alb.x(), albedo_eps), std::max(alb.y(), albedo_eps), std::max(alb.z(), albedo_eps));
+    };
+    for (size_t k = 0; k < n; k++) {
+        int count = fb.samples[k];
+        double inv = count > 0 ? 1.0 / count : 0.0;
+        double inv_aov = fb.aov_samples[k] > 0 ? 1.0 / fb.aov_samples[k] : 0.0;
+        color c = fb.accum[k] * inv;
+        color alb = fb.albedo_sum[k] * inv_aov;
+        vec3 nrm = fb.normal_sum[k] * inv_aov;
+        double len = nrm.length();
+        if (len > 0) nrm = nrm / len;
+        float depth = static_cast<float>(fb.depth_sum[k] * inv_aov);
+
+        gd.nx[k] = static_cast<float>(nrm.x());
+        gd.ny[k] = static_cast<float>(nrm.y());
+        gd.nz[k] = static_cast<float>(nrm.z());
+        gd.ar[k] = static_cast<float>(alb.x());
+        gd.ag[k] = static_cast<float>(alb.y());
+        gd.ab[k] = static_cast<float>(alb.z());
+        gd.depth[k] = depth;
+        gd.inv_depth_scale[k] = 1.0f / (ds.sigma_depth * std::max(depth, 1e-3f));
+
+        color div = divisor(alb);
+        a.r[k] = static_cast<float>(c.x() / div.x());
+        a.g[k] = static_cast<float>(c.y() / div.y());
+        a.b[k] = static_cast<float>(c.z() / div.z());
+        // Variância da média = variância das amostras / n (aproximada para a cor demodulada)
+        double mean = luminance(c);
+        double div_lum = luminance(div);
+        a.var[k] = static_cast<float>(std::max(0.0, fb.luminance2_sum[k] * inv - mean*mean) * inv
+                                      / (div_lum * div_lum));
+    }
+
+    pixel_region all{0, 0, w, h};
+    for (int it = 0; it < ds.iterations; it++) {
+        int step = 1 << it;
+        parallel_tiles(all, ds.tile_size, ds.threads, [&](const pixel_region& tile) {
+            luminance_scale_tile(tile, a, gd, ds);
+        }, "denoise.scale");
+        parallel_tiles(all, ds.tile_size, ds.threads, [&](const pixel_region& tile) {
+            atrous_tile(tile, step, a, b, gd, ds);
+        }, "denoise.atrous");
+        std::swap(a, b);
+    }
+
+    // Multiplica de volta pelo albedo e devolve como soma (resolve() divide por samples)
+    for (size_t k = 0; k < n; k++) {
+        color div = divisor(color(gd.ar[k], gd.ag[k], gd.ab[k]));
+        fb.accum[k] = color(a.r[k], a.g[k], a.b[k]) * div * fb.samples[k];
+    }
+    return true;
+}
+
+#endif
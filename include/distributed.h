@@ -0,0 +1,452 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+// --- Render Distribuído em Tiles (Coordenador / Workers) ---
+//
+// O coordenador divide a imagem em tiles e entrega para processos worker conectados por
+// socket (TCP "host:porta" ou Unix "unix:/caminho"). Cada worker carrega a cena UMA vez e
+// processa quantos tiles receber. Balanceamento dinâmico: cada worker tem no máximo
+// 'tiles_in_flight' tiles pendentes e recebe outro assim que devolve um.
+// Se um worker cai, seus tiles voltam para a fila; se um tile demora demais (worker travado),
+// ele é reenviado para outro worker e vale o primeiro resultado que chegar.
+//
+// Protocolo (linhas de texto + bloco binário):
+//   C -> W  "job largura altura spp lfx lfy lfz lax lay laz vux vuy vuz vfov"
+//   C -> W  "tile id x0 y0 x1 y1"
+//   C -> W  "quit"
+//   W -> C  "result id n" seguido de n*3 floats (soma RGB linear por pixel, x mais rápido)
+// Os floats vão na ordem de bytes da máquina: coordenador e workers devem ter a mesma arquitetura.
+
+#ifndef _WIN32
+
+#include "utils.h"
+#include "scene.h"
+#include "renderer.h"
+#include "framebuffer.h"
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Conexão com leitura bufferizada de linhas e blocos binários
+class socket_channel {
+    public:
+        int fd = -1;
+
+        socket_channel() {}
+        explicit socket_channel(int f) : fd(f) {}
+
+        bool write_all(const void* data, size_t size) {
+            const char* p = static_cast<const char*>(data);
+            while (size > 0) {
+                ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+                if (n <= 0) return false;
+                p += n;
+                size -= n;
+            }
+            return true;
+        }
+
+        bool write_line(const std::string& line) {
+            std::string msg = line + "\n";
+            return write_all(msg.data(), msg.size());
+        }
+
+        bool read_line(std::string& line) {
+            size_t eol;
+            while ((eol = pending.find('\n')) == std::string::npos) {
+                if (!fill()) return false;
+            }
+            line = pending.substr(0, eol);
+            pending.erase(0, eol + 1);
+            return true;
+        }
+
+        bool read_exact(void* data, size_t size) {
+            char* p = static_cast<char*>(data);
+            while (size > 0) {
+                if (pending.empty() && !fill()) return false;
+                size_t n = std::min(size, pending.size());
+                memcpy(p, pending.data(), n);
+                pending.erase(0, n);
+                p += n;
+                size -= n;
+            }
+            return true;
+        }
+
+        // Ainda há dados recebidos e não consumidos (poll() não os enxerga)
+        bool has_buffered_line() const { return pending.find('\n') != std::string::npos; }
+
+        void close_channel() {
+            if (fd >= 0) close(fd);
+            fd = -1;
+        }
+
+    private:
+        std::string pending;
+
+        bool fill() {
+            char buffer[65536];
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) return false;
+            pending.append(buffer, n);
+            return true;
+        }
+};
+
+// Endereço "unix:/caminho" ou "host:porta"
+inline int open_socket(const std::string& address, bool listening) {
+    if (address.compare(0, 5, "unix:") == 0) {
+        std::string path = address.substr(5);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path.c_str());
+        if (listening) {
+            unlink(path.c_str());
+            if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+                close(fd);
+                return -1;
+            }
+        } else if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) return -1;
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (listening) hints.ai_flags = AI_PASSIVE;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result) != 0) return -1;
+
+    int fd = -1;
+    for (addrinfo* ai = result; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (listening) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0) break;
+        } else if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+// --- Worker ---
+// Conecta no coordenador e renderiza tiles até receber "quit" ou a conexão cair.
+// Retorna quantos tiles foram processados (-1 se não conseguiu conectar).
+inline int run_worker(const scene& sc, const std::string& address, const render_settings& settings) {
+    int fd = -1;
+    for (int attempt = 0; attempt < 50 && fd < 0; attempt++) {
+        fd = open_socket(address, false);
+        if (fd < 0) usleep(100000); // O coordenador pode ainda não estar escutando
+    }
+    if (fd < 0) return -1;
+
+    socket_channel channel(fd);
+    view_params view = sc.view;
+    int width = 0, height = 0, spp = 1;
+    int tiles = 0;
+    std::vector<float> payload;
+
+    std::string line;
+    while (channel.read_line(line)) {
+        std::istringstream in(line);
+        std::string cmd;
+        in >> cmd;
+
+        if (cmd == "job") {
+            in >> width >> height >> spp;
+            double v[10];
+            for (double& x : v) in >> x;
+            view.lookfrom = point3(v[0], v[1], v[2]);
+            view.lookat = point3(v[3], v[4], v[5]);
+            view.vup = vec3(v[6], v[7], v[8]);
+            view.vfov = v[9];
+        } else if (cmd == "tile") {
+            int id;
+            pixel_region tile;
+            in >> id >> tile.x0 >> tile.y0 >> tile.x1 >> tile.y1;
+            camera cam = view.make_camera(double(width) / height);
+
+            int tw = tile.x1 - tile.x0;
+            payload.assign(static_cast<size_t>(tile.pixel_count()) * 3, 0.0f);
+            // Paraleliza dentro do tile com sub-tiles menores
+            parallel_tiles(tile, 8, settings.threads, [&](const pixel_region& sub) {
+                ray_stats sub_stats;
+                shadow_cache sub_shadows;
+                for (int j = sub.y0; j < sub.y1; ++j) {
+                    for (int i = sub.x0; i < sub.x1; ++i) {
+                        color c = sample_pixel(cam, sc.root(), sc.lights, i, j, width, height, spp,
+                                               settings.trace, sub_stats, sub_shadows);
+                        size_t k = (static_cast<size_t>(j - tile.y0) * tw + (i - tile.x0)) * 3;
+                        payload[k] = static_cast<float>(c.x());
+                        payload[k+1] = static_cast<float>(c.y());
+                        payload[k+2] = static_cast<float>(c.z());
+                    }
+                }
+            });
+
+            std::ostringstream header;
+            header << "result " << id << ' ' << tile.pixel_count();
+            if (!channel.write_line(header.str()) ||
+                !channel.write_all(payload.data(), payload.size() * sizeof(float))) break;
+            tiles++;
+        } else if (cmd == "quit") {
+            break;
+        }
+    }
+
+    channel.close_channel();
+    return tiles;
+}
+
+// --- Coordenador ---
+struct coordinator_settings {
+    int tile_size = 32;
+    int tiles_in_flight = 2;      // Tiles pendentes por worker (esconde a latência da rede)
+    double stall_min_seconds = 5; // Um tile só é considerado travado depois disso...
+    double stall_factor = 8;      // ... e de stall_factor vezes o tempo médio de um tile
+};
+
+struct coordinator_stats {
+    int workers_seen = 0;
+    int workers_lost = 0;
+    int tiles_reassigned = 0;
+    int duplicate_results = 0;
+};
+
+class render_coordinator {
+    public:
+        coordinator_settings settings;
+        coordinator_stats stats;
+
+        // Renderiza a imagem inteira em fb usando os workers que se conectarem em 'address'.
+        // Retorna false se não foi possível escutar no endereço.
+        bool render(const view_params& view, framebuffer& fb, int spp, const std::string& address) {
+            using clock = std::chrono::steady_clock;
+
+            int server = open_socket(address, true);
+            if (server < 0) return false;
+
+            // Monta a fila de tiles (de cima para baixo)
+            tiles.clear();
+            for (int y1 = fb.height; y1 > 0; y1 -= settings.tile_size) {
+                for (int x0 = 0; x0 < fb.width; x0 += settings.tile_size) {
+                    tile_state t;
+                    t.region = pixel_region{x0, std::max(0, y1 - settings.tile_size),
+                                            std::min(fb.width, x0 + settings.tile_size), y1};
+                    tiles.push_back(t);
+                }
+            }
+            std::deque<int> queue;
+            for (int i = 0; i < static_cast<int>(tiles.size()); i++) queue.push_back(i);
+            int remaining = static_cast<int>(tiles.size());
+
+            // 17 dígitos: o worker reconstrói exatamente a mesma câmera em double
+            std::ostringstream job;
+            job << std::setprecision(17) << "job " << fb.width << ' ' << fb.height << ' ' << spp << ' '
+                << view.lookfrom << ' ' << view.lookat << ' ' << view.vup << ' ' << view.vfov;
+            std::string job_line = job.str();
+
+            std::vector<worker_state> workers;
+            double total_tile_seconds = 0;
+            int timed_tiles = 0;
+            std::vector<float> payload;
+
+            while (remaining > 0) {
+                auto now = clock::now();
+
+                // 1. Reenvia tiles travados (o worker pode estar vivo mas parado)
+                double average = timed_tiles > 0 ? total_tile_seconds / timed_tiles : 0;
+                double stall_limit = std::max(settings.stall_min_seconds, settings.stall_factor * average);
+                for (int id = 0; id < static_cast<int>(tiles.size()); id++) {
+                    tile_state& t = tiles[id];
+                    if (t.done || t.assignments == 0 || t.requeued) continue;
+                    if (std::chrono::duration<double>(now - t.assigned_at).count() > stall_limit) {
+                        t.requeued = true;
+                        queue.push_front(id);
+                        stats.tiles_reassigned++;
+                    }
+                }
+
+                // 2. Distribui trabalho
+                for (auto& w : workers) {
+                    while (w.channel.fd >= 0 && static_cast<int>(w.in_flight.size()) < settings.tiles_in_flight
+                           && !queue.empty()) {
+                        int id = next_tile(queue);
+                        if (id < 0) break;
+                        if (!send_tile(w, id)) {
+                            drop_worker(w, queue);
+                            break;
+                        }
+                    }
+                }
+
+                // 3. Espera eventos (novo worker ou resultado)
+                std::vector<pollfd> fds;
+                fds.push_back(pollfd{server, POLLIN, 0});
+                for (auto& w : workers)
+                    if (w.channel.fd >= 0) fds.push_back(pollfd{w.channel.fd, POLLIN, 0});
+                if (poll(fds.data(), fds.size(), 200) < 0) break;
+
+                if (fds[0].revents & POLLIN) {
+                    int fd = accept(server, nullptr, nullptr);
+                    if (fd >= 0) {
+                        // Um worker que trava no meio de uma mensagem não pode travar o coordenador
+                        timeval timeout{static_cast<time_t>(settings.stall_min_seconds), 0};
+                        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                        workers.push_back(worker_state());
+                        workers.back().channel = socket_channel(fd);
+                        stats.workers_seen++;
+                        if (!workers.back().channel.write_line(job_line)) drop_worker(workers.back(), queue);
+                    }
+                }
+
+                for (auto& w : workers) {
+                    if (w.channel.fd < 0) continue;
+                    bool readable = false;
+                    for (size_t k = 1; k < fds.size(); k++)
+                        if (fds[k].fd == w.channel.fd && (fds[k].revents & (POLLIN | POLLHUP | POLLERR))) readable = true;
+                    if (!readable) continue;
+
+                    do {
+                        std::string line;
+                        int id = -1, count = 0;
+                        if (!w.channel.read_line(line) || sscanf(line.c_str(), "result %d %d", &id, &count) != 2
+                            || id < 0 || id >= static_cast<int>(tiles.size())
+                            || count != tiles[id].region.pixel_count()) {
+                            drop_worker(w, queue);
+                            break;
+                        }
+                        payload.resize(static_cast<size_t>(count) * 3);
+                        if (!w.channel.read_exact(payload.data(), payload.size() * sizeof(float))) {
+                            drop_worker(w, queue);
+                            break;
+                        }
+
+                        tile_state& t = tiles[id];
+                        for (auto it = w.in_flight.begin(); it != w.in_flight.end(); ++it) {
+                            if (*it == id) { w.in_flight.erase(it); break; }
+                        }
+                        w.tiles_done++;
+
+                        if (t.done) {
+                            stats.duplicate_results++;
+                            continue;
+                        }
+                        merge_tile(fb, t.region, payload, spp);
+                        t.done = true;
+                        remaining--;
+                        total_tile_seconds += std::chrono::duration<double>(clock::now() - t.assigned_at).count();
+                        timed_tiles++;
+                    } while (w.channel.has_buffered_line());
+                }
+            }
+
+            for (auto& w : workers) {
+                if (w.channel.fd < 0) continue;
+                w.channel.write_line("quit");
+                w.channel.close_channel();
+            }
+            close(server);
+            if (address.compare(0, 5, "unix:") == 0) unlink(address.substr(5).c_str());
+            return true;
+        }
+
+    private:
+        struct tile_state {
+            pixel_region region;
+            bool done = false;
+            bool requeued = false; // Está na fila por travamento, aguardando outro worker
+            int assignments = 0;
+            std::chrono::steady_clock::time_point assigned_at;
+        };
+
+        struct worker_state {
+            socket_channel channel;
+            std::vector<int> in_flight;
+            int tiles_done = 0;
+        };
+
+        std::vector<tile_state> tiles;
+
+        // Próximo tile ainda não terminado (a fila pode ter reenvios já concluídos)
+        int next_tile(std::deque<int>& queue) {
+            while (!queue.empty()) {
+                int id = queue.front();
+                queue.pop_front();
+                if (!tiles[id].done) return id;
+            }
+            return -1;
+        }
+
+        bool send_tile(worker_state& w, int id) {
+            const pixel_region& r = tiles[id].region;
+            std::ostringstream msg;
+            msg << "tile " << id << ' ' << r.x0 << ' ' << r.y0 << ' ' << r.x1 << ' ' << r.y1;
+            if (!w.channel.write_line(msg.str())) return false;
+            w.in_flight.push_back(id);
+            tiles[id].requeued = false;
+            tiles[id].assignments++;
+            tiles[id].assigned_at = std::chrono::steady_clock::now();
+            return true;
+        }
+
+        // Worker morreu: devolve os tiles pendentes dele para o início da fila
+        void drop_worker(worker_state& w, std::deque<int>& queue) {
+            for (int id : w.in_flight) {
+                if (tiles[id].done) continue;
+                queue.push_front(id);
+                stats.tiles_reassigned++;
+            }
+            w.in_flight.clear();
+            w.channel.close_channel();
+            stats.workers_lost++;
+        }
+
+        static void merge_tile(framebuffer& fb, const pixel_region& r, const std::vector<float>& payload, int spp) {
+            int tw = r.x1 - r.x0;
+            for (int j = r.y0; j < r.y1; ++j) {
+                for (int i = r.x0; i < r.x1; ++i) {
+                    size_t k = (static_cast<size_t>(j - r.y0) * tw + (i - r.x0)) * 3;
+                    size_t idx = fb.index(i, j);
+                    fb.accum[idx] += color(payload[k], payload[k+1], payload[k+2]);
+                    fb.samples[idx] += spp;
+                }
+            }
+        }
+};
+
+#endif // _WIN32
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "utils.h"
+#include "vec3.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// Framebuffer de acumulação: guarda a SOMA das amostras e quantas amostras cada pixel já tem.
+// Assim dá para continuar refinando um pixel depois (sessão interativa) sem perder o que já foi feito.
+// Linha j = 0 é a de baixo, como no loop de render original.
+class framebuffer {
+    public:
+        int width = 0;
+        int height = 0;
+        std::vector<color> accum;  // Soma das cores amostradas
+        std::vector<int> samples;  // Número de amostras acumuladas
+
+        // AOVs opcionais do hit primário (somas, como 'accum'): guias do denoiser (ver denoise.h).
+        // Podem ter mais amostras que a cor (render_aov_region traça só raios primários).
+        std::vector<color> albedo_sum;  // kd->value no ponto atingido
+        std::vector<vec3> normal_sum;   // Normal de sombreamento
+        std::vector<double> depth_sum;  // Distância da câmera
+        std::vector<int> aov_samples;   // Amostras somadas nos três acima
+        std::vector<double> luminance2_sum; // Quadrado da luminância da cor (mesmas amostras de 'accum')
+
+        framebuffer() {}
+        framebuffer(int w, int h) { resize(w, h); }
+
+        void resize(int w, int h) {
+            width = w;
+            height = h;
+            accum.assign(static_cast<size_t>(w) * h, color(0,0,0));
+            samples.assign(static_cast<size_t>(w) * h, 0);
+            if (has_aovs()) enable_aovs();
+        }
+
+        // Passa a acumular os AOVs (só faz sentido com o framebuffer vazio)
+        void enable_aovs() {
+            size_t n = static_cast<size_t>(width) * height;
+            albedo_sum.assign(n, color(0,0,0));
+            normal_sum.assign(n, vec3(0,0,0));
+            depth_sum.assign(n, 0.0);
+            aov_samples.assign(n, 0);
+            luminance2_sum.assign(n, 0.0);
+        }
+
+        bool has_aovs() const { return !albedo_sum.empty(); }
+
+        // Descarta todas as amostras (ex: a câmera mudou)
+        void clear() {
+            std::fill(accum.begin(), accum.end(), color(0,0,0));
+            std::fill(samples.begin(), samples.end(), 0);
+            if (has_aovs()) enable_aovs();
+        }
+
+        size_t index(int i, int j) const { return static_cast<size_t>(j) * width + i; }
+
+        void add_sample(int i, int j, const color& c) {
+            size_t k = index(i, j);
+            accum[k] += c;
+            samples[k]++;
+        }
+
+        // Média das amostras com correção de gama 2 (raiz quadrada)
+        color resolve(int i, int j) const {
+            size_t k = index(i, j);
+            if (samples[k] == 0) return color(0,0,0);
+            auto scale = 1.0 / samples[k];
+            return color(sqrt(scale * accum[k].x()), sqrt(scale * accum[k].y()), sqrt(scale * accum[k].z()));
+        }
+
+        // Saída no formato PPM P3 (de cima para baixo)
+        void write_ppm(std::ostream& out) const {
+            out << "P3\n" << width << ' ' << height << "\n255\n";
+            for (int j = height-1; j >= 0; --j) {
+                for (int i = 0; i < width; ++i) {
+                    color c = resolve(i, j);
+                    out << static_cast<int>(256 * clamp(c.x(), 0.0, 0.999)) << ' '
+                        << static_cast<int>(256 * clamp(c.y(), 0.0, 0.999)) << ' '
+                        << static_cast<int>(256 * clamp(c.z(), 0.0, 0.999)) << '\n';
+                }
+            }
+        }
+};
+
+#endif
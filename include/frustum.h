@@ -0,0 +1,193 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "utils.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "bvh.h"
+#include "camera.h"
+#include "instance_table.h"
+
+#include <vector>
+
+// --- Culling por Tile (raios primários) ---
+//
+// Os raios primários de um tile saem todos da câmera dentro de uma pirâmide estreita. Antes de
+// renderizar o tile, a pirâmide é testada contra as caixas da cena (nós da BVH do mundo e, dentro
+// de uma instance_table, as folhas da BVH das instâncias) e o que sobra vira uma lista curta de
+// candidatos. tile_candidates é um hittable que embrulha o mundo:
+//   - raio primário do tile (sai da câmera e a direção está dentro da pirâmide): testa só os
+//     candidatos, cada um atrás da sua caixa;
+//   - qualquer outro raio (sombra, reflexo, refração): vai direto para o mundo.
+// Se a lista passar de 'max_candidates' (tile perto do horizonte de uma floresta) a tabela de
+// instâncias entra inteira, com a própria BVH; se ainda assim passar, o tile usa o mundo.
+// Câmera com lente (aperture > 0) não tem um ápice único: o culling fica desligado.
+
+// Pirâmide com ápice na câmera: 4 planos pela origem com normais para dentro
+class tile_frustum {
+    public:
+        point3 apex;
+        vec3 normals[4];
+
+        // Pixels [x0, x1) x [y0, y1) de uma imagem width x height (mesmo mapeamento de sample_pixel),
+        // com meio pixel de folga em cada lado. Retorna false se a câmera tiver lente.
+        bool build(const camera& cam, int x0, int y0, int x1, int y1, int width, int height) {
+            if (cam.lens_radius > 0) return false;
+            apex = cam.origin;
+            double s0 = (x0 - 0.5) / (width-1), s1 = (x1 + 0.5) / (width-1);
+            double t0 = (y0 - 0.5) / (height-1), t1 = (y1 + 0.5) / (height-1);
+            vec3 corner[4] = {direction(cam, s0, t0), direction(cam, s1, t0),
+                              direction(cam, s1, t1), direction(cam, s0, t1)};
+            vec3 center = direction(cam, 0.5 * (s0 + s1), 0.5 * (t0 + t1));
+            for (int k = 0; k < 4; k++) {
+                vec3 n = cross(corner[k], corner[(k+1) % 4]);
+                normals[k] = dot(n, center) < 0 ? -n : n;
+            }
+            return true;
+        }
+
+        // Falso só se a caixa estiver inteira do lado de fora de algum plano (conservador)
+        bool overlaps(const aabb& box) const {
+            if (box.is_empty()) return false;
+            for (int k = 0; k < 4; k++) {
+                const vec3& n = normals[k];
+                // Canto da caixa mais para dentro do plano
+                point3 p(n.x() >= 0 ? box.maximum.x() : box.minimum.x(),
+                         n.y() >= 0 ? box.maximum.y() : box.minimum.y(),
+                         n.z() >= 0 ? box.maximum.z() : box.minimum.z());
+                if (dot(n, p - apex) < 0) return false;
+            }
+            return true;
+        }
+
+        // O raio sai do ápice e a direção está dentro da pirâmide
+        bool contains(const ray& r) const {
+            if (r.orig.x() != apex.x() || r.orig.y() != apex.y() || r.orig.z() != apex.z()) return false;
+            for (int k = 0; k < 4; k++)
+                if (dot(normals[k], r.dir) < 0) return false;
+            return true;
+        }
+
+    private:
+        static vec3 direction(const camera& cam, double s, double t) {
+            return cam.lower_left_corner + s*cam.horizontal + t*cam.vertical - cam.origin;
+        }
+};
+
+class tile_candidates : public hittable {
+    public:
+        size_t max_candidates = 64;
+
+        explicit tile_candidates(const hittable& scene_world) : world(scene_world) {}
+
+        // Monta a lista do tile. Retorna false se o tile vai usar o mundo inteiro.
+        bool build(const camera& cam, int x0, int y0, int x1, int y1, int width, int height) {
+            objects.clear();
+            ranges.clear();
+            active = frustum.build(cam, x0, y0, x1, y1, width, height);
+            if (!active) return false;
+
+            if (const bvh* tree = dynamic_cast<const bvh*>(&world)) {
+                active = collect_bvh(*tree);
+            } else if (const hittable_list* list = dynamic_cast<const hittable_list*>(&world)) {
+                for (const auto& object : list->objects)
+                    if (!(active = add_object(object.get()))) break;
+            } else {
+                active = false;
+            }
+            return active;
+        }
+
+        bool culling() const { return active; }
+        size_t candidate_count() const { return objects.size() + ranges.size(); }
+
+        virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override {
+            if (!active || !frustum.contains(r)) return world.hit(r, t_min, t_max, rec);
+
+            vec3 d = r.direction();
+            vec3 inv_dir(1.0/d.x(), 1.0/d.y(), 1.0/d.z());
+            hit_record temp_rec;
+            bool hit_anything = false;
+            auto closest_so_far = t_max;
+
+            for (const object_entry& e : objects) {
+                if (!e.box.hit(r, inv_dir, t_min, closest_so_far)) continue;
+                if (e.object->hit(r, t_min, closest_so_far, temp_rec)) {
+                    hit_anything = true;
+                    closest_so_far = temp_rec.t;
+                    rec = temp_rec;
+                    rec.object = e.object;
+                }
+            }
+            // Faixas de instâncias: o objeto de primeiro nível continua sendo a tabela
+            for (const range_entry& e : ranges) {
+                if (!e.range.box.hit(r, inv_dir, t_min, closest_so_far)) continue;
+                if (e.table->hit_range(e.range, r, t_min, closest_so_far, temp_rec)) {
+                    hit_anything = true;
+                    closest_so_far = temp_rec.t;
+                    rec = temp_rec;
+                    rec.object = e.table;
+                }
+            }
+            return hit_anything;
+        }
+
+        virtual bool bounding_box(aabb& output_box) const override { return world.bounding_box(output_box); }
+
+    private:
+        struct object_entry {
+            aabb box;
+            const hittable* object;
+        };
+
+        struct range_entry {
+            instance_table::instance_range range;
+            const instance_table* table;
+        };
+
+        const hittable& world;
+        tile_frustum frustum;
+        bool active = false;
+        std::vector<object_entry> objects;
+        std::vector<range_entry> ranges;
+        std::vector<instance_table::instance_range> scratch;
+
+        bool collect_bvh(const bvh& tree) {
+            if (tree.nodes.empty()) return true;
+            int stack[64];
+            int sp = 0;
+            stack[sp++] = 0;
+            while (sp > 0) {
+                const bvh::node& nd = tree.nodes[stack[--sp]];
+                if (!frustum.overlaps(nd.box)) continue;
+                if (!nd.is_leaf()) {
+                    stack[sp++] = nd.right;
+                    stack[sp++] = nd.left;
+                    continue;
+                }
+                for (int i = nd.first; i < nd.first + nd.count; i++)
+                    if (!add_object(tree.objects[tree.prim_index[i]].get())) return false;
+            }
+            return true;
+        }
+
+        bool add_object(const hittable* object) {
+            aabb box;
+            if (!object->bounding_box(box) || !frustum.overlaps(box)) return true;
+
+            if (const instance_table* table = dynamic_cast<const instance_table*>(object)) {
+                scratch.clear();
+                size_t room = max_candidates - std::min(max_candidates, candidate_count());
+                if (table->collect_leaves([&](const aabb& b) { return frustum.overlaps(b); }, room, scratch)) {
+                    for (const auto& range : scratch) ranges.push_back(range_entry{range, table});
+                    return true;
+                }
+                // Folhas demais: a tabela entra inteira
+            }
+            if (candidate_count() >= max_candidates) return false;
+            objects.push_back(object_entry{box, object});
+            return true;
+        }
+};
+
+#endif
@@ -2,14 +2,16 @@
 #define HITTABLE_H
 
 #include "ray.h"
+#include "aabb.h"
 #include <memory> // Necessário para smart pointers
 
 class material; // "Forward declaration": avisa que a classe material vai existir no futuro
+class hittable;
 
 struct hit_record {
     point3 p;         // Ponto onde o raio bateu
     vec3 normal;      // O vetor normal nesse ponto
-    std::shared_ptr<material> mat_ptr; // Do que é feito esse objeto?
+    material* mat_ptr = nullptr;  // Do que é feito esse objeto? (não é dono: o objeto atingido é)
     double t;         // A distância t onde bateu
     
     // Coordenadas de Textura (Requisito 1.3.3)
@@ -18,6 +20,9 @@ struct hit_record {
     
     bool front_face;  // True se o raio bateu de fora, False se bateu de dentro
 
+    // Objeto de primeiro nível atingido (preenchido pela lista/BVH da cena; usado pelo cache de sombras)
+    const hittable* object = nullptr;
+
     // Define a normal sempre contra o raio
     inline void set_face_normal(const ray& r, const vec3& outward_normal) {
         // Se o produto escalar é negativo, eles são opostos (raio entra na face)
@@ -30,6 +35,9 @@ class hittable {
     public:
         // Função virtual pura: obriga as filhas (Sphere, Cone, Mesh) a implementarem
         virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const = 0;
+
+        // Caixa envolvente no espaço do próprio objeto (usada pela BVH)
+        virtual bool bounding_box(aabb& output_box) const = 0;
 };
 
 #endif
\ No newline at end of file
@@ -31,11 +31,25 @@ class hittable_list : public hittable {
                     hit_anything = true;
                     closest_so_far = temp_rec.t; // Atualiza o "recorde" de distância
                     rec = temp_rec;              // Salva os dados da interseção
+                    rec.object = object.get();
                 }
             }
 
             return hit_anything;
         }
+
+        // União das caixas de todos os filhos
+        virtual bool bounding_box(aabb& output_box) const override {
+            if (objects.empty()) return false;
+
+            aabb temp_box;
+            output_box = aabb();
+            for (const auto& object : objects) {
+                if (!object->bounding_box(temp_box)) return false;
+                output_box = surrounding_box(output_box, temp_box);
+            }
+            return true;
+        }
 };
 
 #endif
\ No newline at end of file
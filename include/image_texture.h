@@ -0,0 +1,376 @@
+#ifndef IMAGE_TEXTURE_H
+#define IMAGE_TEXTURE_H
+
+#include "utils.h"
+#include "texture.h"
+#include "lru_cache.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// --- Texturas de Imagem (mip-maps em tiles + cache LRU) ---
+//
+// A imagem (PPM P3/P6) é lida UMA linha por vez: cada nível da pirâmide de mip-maps junta
+// 'tile_size' linhas numa faixa, grava a faixa como tiles num arquivo temporário e manda as
+// linhas reduzidas (média 2x2) para o nível seguinte. Nem a imagem nem a pirâmide inteira ficam
+// na memória: durante o render os tiles são lidos do arquivo sob demanda para um cache LRU
+// compartilhado entre todas as texturas, com teto de bytes. Uma cena com gigabytes de texturas
+// usa só o que cabe no teto (mais o disco do arquivo temporário, ~4/3 do tamanho das imagens).
+//
+// Filtragem trilinear: o nível vem da pegada do raio (ver texture_footprint e ray_footprint em
+// renderer.h), que cresce com a distância e com o ângulo de um pixel da câmera.
+
+// Tile de RGB em 8 bits com gama 2 (tile_size x tile_size; tiles da borda são completados com zeros)
+struct texture_tile {
+    std::vector<unsigned char> texels;
+};
+
+struct texture_tile_bytes {
+    size_t operator()(const texture_tile& t) const { return t.texels.size() + sizeof(texture_tile); }
+};
+
+// Cache LRU de tiles com teto de memória, compartilhado por várias image_texture
+class texture_cache : public lru_cache<uint64_t, texture_tile, texture_tile_bytes> {
+    public:
+        explicit texture_cache(size_t max_bytes = size_t(256) << 20) : lru_cache(max_bytes) {}
+
+        uint32_t register_texture() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return next_texture++;
+        }
+
+        void print(std::ostream& out) const { print_counters(out, "Cache de texturas", "tiles", "leituras"); }
+
+    private:
+        uint32_t next_texture = 0;
+};
+
+class image_texture : public texture {
+    public:
+        // > 0: ignora o UV do objeto e projeta a imagem no plano XZ, repetindo a cada
+        // 'planar_scale' unidades do mundo (chão, paredes grandes)
+        double planar_scale = 0.0;
+
+        image_texture(shared_ptr<texture_cache> tile_cache, int tile = 64)
+            : cache(tile_cache), tile_size(tile), id(tile_cache->register_texture()) {}
+
+        ~image_texture() {
+            if (file) std::fclose(file);
+        }
+
+        image_texture(const image_texture&) = delete;
+        image_texture& operator=(const image_texture&) = delete;
+
+        // Lê um PPM (P3 ou P6, 8 ou 16 bits) e monta a pirâmide de tiles. Retorna false se o
+        // arquivo não existir ou não for um PPM válido (a textura fica cinza).
+        bool load(const char* path) {
+            ppm_reader in;
+            if (!in.open(path)) return false;
+
+            if (file) std::fclose(file);
+            file = std::tmpfile();
+            if (!file) return false;
+
+            levels.clear();
+            long tiles = 0;
+            for (int w = in.width, h = in.height;; w = std::max(1, w/2), h = std::max(1, h/2)) {
+                level_info lv{w, h, (w + tile_size - 1) / tile_size, (h + tile_size - 1) / tile_size, tiles};
+                tiles += static_cast<long>(lv.tiles_x) * lv.tiles_y;
+                levels.push_back(lv);
+                if (w == 1 && h == 1) break;
+            }
+
+            std::vector<level_builder> builders(levels.size());
+            for (size_t l = 0; l < levels.size(); l++) {
+                builders[l].strip.assign(static_cast<size_t>(tile_size) * levels[l].width * 3, 0);
+                builders[l].pending.assign(static_cast<size_t>(levels[l].width) * 3, 0);
+            }
+
+            std::vector<unsigned char> row(static_cast<size_t>(in.width) * 3);
+            for (int y = 0; y < in.height; y++) {
+                if (!in.read_row(row.data())) {
+                    levels.clear();
+                    return false;
+                }
+                push_row(builders, 0, row.data());
+            }
+            std::fflush(file);
+            return true;
+        }
+
+        bool loaded() const { return !levels.empty(); }
+        int width() const { return levels.empty() ? 0 : levels[0].width; }
+        int height() const { return levels.empty() ? 0 : levels[0].height; }
+        int level_count() const { return static_cast<int>(levels.size()); }
+
+        // Sem pegada: bilinear no nível mais detalhado
+        virtual color value(double u, double v, const point3& p) const override {
+            if (levels.empty()) return color(0.5, 0.5, 0.5);
+            double s, t;
+            coordinates(u, v, p, s, t);
+            tile_ref ref;
+            return bilinear(0, s, t, ref);
+        }
+
+        // Trilinear: o nível é log2 do número de texels (do nível 0) que a pegada cobre
+        virtual color filtered_value(double u, double v, const point3& p, const texture_footprint& fp) const override {
+            if (levels.empty()) return color(0.5, 0.5, 0.5);
+            double s, t;
+            coordinates(u, v, p, s, t);
+
+            double width_st = planar_scale > 0 ? fp.world / planar_scale : fp.uv;
+            double texels = width_st * std::max(levels[0].width, levels[0].height);
+            double lod = texels > 1.0 ? log2(texels) : 0.0;
+            int last = static_cast<int>(levels.size()) - 1;
+            if (lod >= last) lod = last;
+
+            int l0 = static_cast<int>(lod);
+            double f = lod - l0;
+            tile_ref ref;
+            color c0 = bilinear(l0, s, t, ref);
+            if (f <= 0.0 || l0 == last) return c0;
+            return (1.0 - f) * c0 + f * bilinear(l0 + 1, s, t, ref);
+        }
+
+        virtual bool uses_footprint() const override { return true; }
+
+    private:
+        struct level_info {
+            int width, height;
+            int tiles_x, tiles_y;
+            long first_tile; // Posição (em tiles) do primeiro tile do nível no arquivo
+        };
+
+        // Estado de um nível durante a montagem
+        struct level_builder {
+            std::vector<unsigned char> strip;   // Até tile_size linhas ainda não gravadas
+            std::vector<unsigned char> pending; // Linha par esperando a ímpar para a média 2x2
+            std::vector<unsigned char> reduced; // Linha reduzida enviada ao próximo nível
+            int rows = 0;                       // Linhas recebidas
+            int strip_rows = 0;                 // Linhas na faixa atual
+        };
+
+        // Último tile usado numa amostra (os 4 ou 8 texels quase sempre caem no mesmo tile)
+        struct tile_ref {
+            uint64_t key = ~uint64_t(0);
+            shared_ptr<const texture_tile> tile;
+        };
+
+        // Leitor de PPM linha a linha
+        struct ppm_reader {
+            std::FILE* f = nullptr;
+            int width = 0, height = 0, maxval = 0;
+            bool binary = false;
+
+            ~ppm_reader() { if (f) std::fclose(f); }
+
+            bool open(const char* path) {
+                f = std::fopen(path, "rb");
+                if (!f) return false;
+                char magic[3] = {0, 0, 0};
+                if (std::fread(magic, 1, 2, f) != 2 || magic[0] != 'P' || (magic[1] != '3' && magic[1] != '6'))
+                    return false;
+                binary = magic[1] == '6';
+                if (!header_int(width) || !header_int(height) || !header_int(maxval)) return false;
+                if (width <= 0 || height <= 0 || maxval <= 0 || maxval > 65535) return false;
+                if (binary) std::fgetc(f); // Um espaço separa o cabeçalho dos dados
+                return true;
+            }
+
+            // Linha em RGB de 8 bits (a primeira linha do arquivo é o topo da imagem)
+            bool read_row(unsigned char* out) {
+                int n = width * 3;
+                if (binary && maxval < 256) {
+                    if (std::fread(out, 1, n, f) != static_cast<size_t>(n)) return false;
+                    if (maxval != 255)
+                        for (int k = 0; k < n; k++) out[k] = static_cast<unsigned char>(out[k] * 255 / maxval);
+                    return true;
+                }
+                for (int k = 0; k < n; k++) {
+                    int value;
+                    if (binary) {
+                        int hi = std::fgetc(f), lo = std::fgetc(f);
+                        if (lo == EOF) return false;
+                        value = (hi << 8) | lo;
+                    } else if (std::fscanf(f, "%d", &value) != 1) {
+                        return false;
+                    }
+                    out[k] = static_cast<unsigned char>(std::min(std::max(value, 0), maxval) * 255 / maxval);
+                }
+                return true;
+            }
+
+            // Inteiro do cabeçalho, pulando espaços e comentários (#)
+            bool header_int(int& value) {
+                int c = std::fgetc(f);
+                while (c == '#' || isspace(c)) {
+                    if (c == '#') while (c != '\n' && c != EOF) c = std::fgetc(f);
+                    c = std::fgetc(f);
+                }
+                if (c == EOF) return false;
+                std::ungetc(c, f);
+                return std::fscanf(f, "%d", &value) == 1;
+            }
+        };
+
+        shared_ptr<texture_cache> cache;
+        int tile_size;
+        uint32_t id;
+        std::FILE* file = nullptr;
+        std::vector<level_info> levels;
+#ifdef _WIN32
+        mutable std::mutex file_mutex;
+#endif
+
+        size_t tile_bytes() const { return static_cast<size_t>(tile_size) * tile_size * 3; }
+
+        void coordinates(double u, double v, const point3& p, double& s, double& t) const {
+            if (planar_scale > 0) {
+                s = p.x() / planar_scale;
+                t = p.z() / planar_scale;
+            } else {
+                s = u;
+                t = v;
+            }
+        }
+
+        // --- Montagem ---
+
+        void push_row(std::vector<level_builder>& builders, size_t l, const unsigned char* row) {
+            level_builder& b = builders[l];
+            const level_info& lv = levels[l];
+            size_t row_bytes = static_cast<size_t>(lv.width) * 3;
+
+            std::copy(row, row + row_bytes, b.strip.begin() + b.strip_rows * row_bytes);
+            b.strip_rows++;
+            int y = b.rows++;
+            if (b.strip_rows == tile_size || b.rows == lv.height) write_strip(l, y / tile_size, b);
+
+            if (l + 1 >= levels.size()) return;
+            // Média 2x2 para o próximo nível; com altura ímpar a última linha sobra (ou é usada
+            // sozinha quando o próximo nível ainda não tem todas as linhas, caso altura 1)
+            if (y % 2 == 0) {
+                std::copy(row, row + row_bytes, b.pending.begin());
+                if (b.rows == lv.height && builders[l+1].rows < levels[l+1].height)
+                    push_row(builders, l + 1, downsample(b.pending.data(), b.pending.data(), lv.width, b.reduced));
+            } else {
+                push_row(builders, l + 1, downsample(b.pending.data(), row, lv.width, b.reduced));
+            }
+        }
+
+        // Reduz duas linhas de largura 'w' para uma de largura max(1, w/2)
+        static const unsigned char* downsample(const unsigned char* a, const unsigned char* b, int w,
+                                               std::vector<unsigned char>& reduced) {
+            int half = std::max(1, w / 2);
+            reduced.resize(static_cast<size_t>(half) * 3);
+            for (int x = 0; x < half; x++) {
+                int x0 = std::min(2*x, w - 1), x1 = std::min(2*x + 1, w - 1);
+                for (int c = 0; c < 3; c++) {
+                    // Média em espaço linear, gravada de novo com gama 2
+                    double linear = 0.25 * (decode(a[x0*3 + c]) + decode(a[x1*3 + c]) + decode(b[x0*3 + c]) + decode(b[x1*3 + c]));
+                    reduced[x*3 + c] = static_cast<unsigned char>(sqrt(linear) * 255.0 + 0.5);
+                }
+            }
+            return reduced.data();
+        }
+
+        void write_strip(size_t l, int strip_index, level_builder& b) {
+            const level_info& lv = levels[l];
+            std::vector<unsigned char> tile(tile_bytes(), 0);
+            for (int tx = 0; tx < lv.tiles_x; tx++) {
+                std::fill(tile.begin(), tile.end(), 0);
+                int x0 = tx * tile_size;
+                int columns = std::min(tile_size, lv.width - x0);
+                for (int r = 0; r < b.strip_rows; r++)
+                    std::copy(b.strip.begin() + (static_cast<size_t>(r) * lv.width + x0) * 3,
+                              b.strip.begin() + (static_cast<size_t>(r) * lv.width + x0 + columns) * 3,
+                              tile.begin() + static_cast<size_t>(r) * tile_size * 3);
+                long long index = lv.first_tile + static_cast<long long>(strip_index) * lv.tiles_x + tx;
+                seek(file, index * static_cast<long long>(tile_bytes()));
+                std::fwrite(tile.data(), 1, tile.size(), file);
+            }
+            b.strip_rows = 0;
+        }
+
+        // Offsets de 64 bits: o arquivo de tiles passa de 2 GB com texturas grandes (long tem 32 bits no Windows)
+        static bool seek(FILE* f, long long offset) {
+#ifndef _WIN32
+            return fseeko(f, static_cast<off_t>(offset), SEEK_SET) == 0;
+#else
+            return _fseeki64(f, offset, SEEK_SET) == 0;
+#endif
+        }
+
+        // --- Amostragem ---
+
+        shared_ptr<const texture_tile> read_tile(int l, int tx, int ty) const {
+            auto tile = make_shared<texture_tile>();
+            tile->texels.resize(tile_bytes());
+            long long index = levels[l].first_tile + static_cast<long long>(ty) * levels[l].tiles_x + tx;
+            long long offset = index * static_cast<long long>(tile_bytes());
+#ifndef _WIN32
+            // pread não mexe na posição do arquivo: threads (e workers criados com fork) leem juntos
+            if (pread(fileno(file), tile->texels.data(), tile_bytes(), static_cast<off_t>(offset)) != static_cast<ssize_t>(tile_bytes()))
+                std::fill(tile->texels.begin(), tile->texels.end(), 0);
+#else
+            std::lock_guard<std::mutex> lock(file_mutex);
+            seek(file, offset);
+            if (std::fread(tile->texels.data(), 1, tile_bytes(), file) != tile_bytes())
+                std::fill(tile->texels.begin(), tile->texels.end(), 0);
+#endif
+            return tile;
+        }
+
+        // Texel (x, y) do nível l, com x e y já dentro da imagem
+        color texel(int l, int x, int y, tile_ref& ref) const {
+            int tx = x / tile_size, ty = y / tile_size;
+            uint64_t key = (uint64_t(id) << 48) | (uint64_t(l) << 42) | (uint64_t(ty) << 21) | uint64_t(tx);
+            if (key != ref.key) {
+                ref.tile = cache->fetch(key, [&]() { return read_tile(l, tx, ty); });
+                ref.key = key;
+            }
+            const unsigned char* c = &ref.tile->texels[(static_cast<size_t>(y % tile_size) * tile_size + x % tile_size) * 3];
+            return color(decode(c[0]), decode(c[1]), decode(c[2]));
+        }
+
+        // Bilinear com repetição (s, t fora de [0, 1) dão a volta); t = 1 é o topo da imagem
+        color bilinear(int l, double s, double t, tile_ref& ref) const {
+            const level_info& lv = levels[l];
+            double x = (s - floor(s)) * lv.width - 0.5;
+            double y = (1.0 - (t - floor(t))) * lv.height - 0.5;
+            int x0 = static_cast<int>(floor(x)), y0 = static_cast<int>(floor(y));
+            double fx = x - x0, fy = y - y0;
+            int x1 = wrap(x0 + 1, lv.width), y1 = wrap(y0 + 1, lv.height);
+            x0 = wrap(x0, lv.width);
+            y0 = wrap(y0, lv.height);
+
+            color top = (1.0 - fx) * texel(l, x0, y0, ref) + fx * texel(l, x1, y0, ref);
+            color bottom = (1.0 - fx) * texel(l, x0, y1, ref) + fx * texel(l, x1, y1, ref);
+            return (1.0 - fy) * top + fy * bottom;
+        }
+
+        // O PPM guarda cores com gama 2 (como framebuffer::resolve grava): volta para linear
+        static double decode(unsigned char v) {
+            static const std::vector<double> table = [] {
+                std::vector<double> t(256);
+                for (int k = 0; k < 256; k++) t[k] = (k / 255.0) * (k / 255.0);
+                return t;
+            }();
+            return table[v];
+        }
+
+        static int wrap(int k, int n) {
+            k %= n;
+            return k < 0 ? k + n : k;
+        }
+};
+
+#endif
@@ -11,24 +11,28 @@ class instance : public hittable {
         shared_ptr<hittable> ptr;
         mat4 transform_matrix;
         mat4 inverse_matrix; // Precisamos da inversa para o raio
+        mat4 normal_matrix;  // Transposta da inversa: leva normais para o mundo (escala não uniforme inclusive)
 
-        instance(shared_ptr<hittable> p, mat4 m) : ptr(p), transform_matrix(m) {
-            // AQUI DEVÍAMOS CALCULAR A INVERSA REAL
-            // Como mat4.h é simples, vamos assumir que o usuário passa a inversa no construtor
-            // ou implementaremos uma inversa simples para translação/rotação depois.
-            // Hack temporário: Para este trabalho, passaremos a inversa manualmente na main se precisar,
-            // ou implementaremos translações inversas simples.
-            
-            // Para simplificar a vida do Thiago agora:
-            // Vamos focar que a matriz M move o objeto do Local -> Mundo
-            // O Raio deve ir do Mundo -> Local, então precisa de M_inv.
-            // Vou assumir que 'm' já é a transformação desejada e vamos tentar inverter translação simples aqui.
-        }
-        
-        // Construtor melhor: guarda a matriz e sua inversa
+        aabb local_box;      // Caixa do objeto no espaço local (calculada uma vez)
+        bool has_box;
+
+        // Construtor com inversa calculada (Gauss-Jordan)
+        instance(shared_ptr<hittable> p, mat4 m)
+            : instance(p, m, m.inverse()) {}
+
+        // Construtor melhor: guarda a matriz e sua inversa (quando conhecida analiticamente)
         instance(shared_ptr<hittable> p, mat4 m, mat4 m_inv) 
-            : ptr(p), transform_matrix(m), inverse_matrix(m_inv) {}
+            : ptr(p), transform_matrix(m), inverse_matrix(m_inv), normal_matrix(m_inv.transpose()) {
+            has_box = ptr->bounding_box(local_box);
+        }
 
+        // Troca a transformação (animação). A caixa no mundo muda junto,
+        // então a estrutura de aceleração que contém esta instância precisa de refit.
+        void set_transform(const mat4& m, const mat4& m_inv) {
+            transform_matrix = m;
+            inverse_matrix = m_inv;
+            normal_matrix = m_inv.transpose();
+        }
 
         virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override {
             // 1. Transforma o raio para o espaço do objeto (Mundo -> Local)
@@ -41,14 +45,31 @@ class instance : public hittable {
             if (!ptr->hit(ray_local, t_min, t_max, rec))
                 return false;
 
-            // 3. Transforma o ponto de impacto e a normal de volta para o mundo
+            // 3. Transforma o ponto de impacto e a normal de volta para o mundo. A normal que sai
+            // do objeto é a externa (desfaz o ajuste contra o raio local) pela transposta da inversa.
             vec4 p_world = transform_matrix * vec4(rec.p, 1.0);
-            vec4 n_world = transform_matrix * vec4(rec.normal, 0.0); // Nota: normais transformam diferente com escala (transposta da inversa), mas para rotação/translação ok.
+            vec3 outward = rec.front_face ? rec.normal : -rec.normal;
+            vec4 n_world = normal_matrix * vec4(outward, 0.0);
 
             rec.p = p_world.to_vec3();
-            rec.normal = unit_vector(n_world.to_vec3());
-            rec.set_face_normal(ray_local, rec.normal); // Reajusta face
+            rec.set_face_normal(r, unit_vector(n_world.to_vec3())); // Reajusta face contra o raio do mundo
+
+            return true;
+        }
+
+        // Transforma os 8 cantos da caixa local e pega a caixa que os envolve
+        virtual bool bounding_box(aabb& output_box) const override {
+            if (!has_box) return false;
 
+            output_box = aabb();
+            for (int i = 0; i < 8; i++) {
+                point3 corner(
+                    (i & 1) ? local_box.maximum.x() : local_box.minimum.x(),
+                    (i & 2) ? local_box.maximum.y() : local_box.minimum.y(),
+                    (i & 4) ? local_box.maximum.z() : local_box.minimum.z());
+                point3 p = (transform_matrix * vec4(corner, 1.0)).to_vec3();
+                output_box = surrounding_box(output_box, aabb(p, p));
+            }
             return true;
         }
 };
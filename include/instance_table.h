@@ -0,0 +1,343 @@
+#ifndef INSTANCE_TABLE_H
+#define INSTANCE_TABLE_H
+
+#include "utils.h"
+#include "hittable.h"
+#include "mat4.h"
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// --- Tabela Compacta de Instâncias ---
+//
+// Cada 'instance' guarda duas mat4 em double (256 bytes) e um shared_ptr, o que limita
+// cenas com muitas cópias (floresta, multidão). Aqui cada instância ocupa 56 bytes:
+//   - transformação afim 3x4 em float (a última linha de uma afim é sempre 0 0 0 1);
+//   - id de 32 bits da geometria (cilindro, cone, malha... registrada uma vez só);
+//   - handle de 32 bits de material que substitui o da geometria (ou sem_override).
+// A inversa não é guardada: é derivada só quando o raio chega na folha da instância.
+// A BVH usa caixas em float e folhas de até 4 instâncias (32 bytes por nó).
+
+// Transformação afim 3x4 em float (linha, coluna)
+struct affine3x4 {
+    float m[3][4];
+
+    static affine3x4 from_mat4(const mat4& a) {
+        affine3x4 r;
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 4; j++)
+                r.m[i][j] = static_cast<float>(a[i][j]);
+        return r;
+    }
+
+    point3 apply_point(const point3& p) const {
+        return point3(m[0][0]*p.x() + m[0][1]*p.y() + m[0][2]*p.z() + m[0][3],
+                      m[1][0]*p.x() + m[1][1]*p.y() + m[1][2]*p.z() + m[1][3],
+                      m[2][0]*p.x() + m[2][1]*p.y() + m[2][2]*p.z() + m[2][3]);
+    }
+
+    vec3 apply_vector(const vec3& v) const {
+        return vec3(m[0][0]*v.x() + m[0][1]*v.y() + m[0][2]*v.z(),
+                    m[1][0]*v.x() + m[1][1]*v.y() + m[1][2]*v.z(),
+                    m[2][0]*v.x() + m[2][1]*v.y() + m[2][2]*v.z());
+    }
+
+    // Aplica a transposta da parte linear (para levar normais de volta com a inversa)
+    vec3 apply_transposed(const vec3& v) const {
+        return vec3(m[0][0]*v.x() + m[1][0]*v.y() + m[2][0]*v.z(),
+                    m[0][1]*v.x() + m[1][1]*v.y() + m[2][1]*v.z(),
+                    m[0][2]*v.x() + m[1][2]*v.y() + m[2][2]*v.z());
+    }
+
+    // Inversa da afim: [A t]^-1 = [A^-1  -A^-1 t] (A^-1 pela adjunta, em double)
+    affine3x4 inverse() const {
+        double a = m[0][0], b = m[0][1], c = m[0][2];
+        double d = m[1][0], e = m[1][1], f = m[1][2];
+        double g = m[2][0], h = m[2][1], k = m[2][2];
+        double A = e*k - f*h, B = f*g - d*k, C = d*h - e*g;
+        double det = a*A + b*B + c*C;
+        double inv_det = fabs(det) < 1e-20 ? 0.0 : 1.0 / det;
+
+        double r[3][3] = {
+            {A*inv_det, (c*h - b*k)*inv_det, (b*f - c*e)*inv_det},
+            {B*inv_det, (a*k - c*g)*inv_det, (c*d - a*f)*inv_det},
+            {C*inv_det, (b*g - a*h)*inv_det, (a*e - b*d)*inv_det}};
+
+        affine3x4 out;
+        for (int i = 0; i < 3; i++) {
+            out.m[i][0] = static_cast<float>(r[i][0]);
+            out.m[i][1] = static_cast<float>(r[i][1]);
+            out.m[i][2] = static_cast<float>(r[i][2]);
+            out.m[i][3] = static_cast<float>(-(r[i][0]*m[0][3] + r[i][1]*m[1][3] + r[i][2]*m[2][3]));
+        }
+        return out;
+    }
+};
+
+struct instance_record {
+    affine3x4 transform;  // Local -> Mundo
+    uint32_t geometry;    // Índice em instance_table::geometry
+    uint32_t material;    // Handle em instance_table::materials ou no_override
+};
+
+class instance_table : public hittable {
+    public:
+        static const uint32_t no_override = 0xffffffffu;
+
+        handle_table<hittable> geometry;
+        handle_table<material> materials;
+        std::vector<instance_record> instances;
+
+        uint32_t add_geometry(shared_ptr<hittable> g) {
+            uint32_t id = geometry.add(g);
+            if (id >= geometry_boxes.size()) {
+                aabb box;
+                if (!g->bounding_box(box)) box = aabb();
+                geometry_boxes.push_back(box);
+            }
+            return id;
+        }
+
+        uint32_t add_material(shared_ptr<material> m) { return materials.add(m); }
+
+        void add(uint32_t geometry_id, const mat4& transform, uint32_t material_override = no_override) {
+            instances.push_back(instance_record{affine3x4::from_mat4(transform), geometry_id, material_override});
+        }
+
+        void reserve(size_t n) { instances.reserve(n); }
+
+        // Monta a BVH (chamar depois de adicionar todas). Reordena 'instances'.
+        void build() {
+            nodes.clear();
+            if (instances.empty()) return;
+
+            std::vector<aabb> boxes(instances.size());
+            std::vector<uint32_t> order(instances.size());
+            for (uint32_t k = 0; k < instances.size(); k++) {
+                boxes[k] = world_box(instances[k]);
+                order[k] = k;
+            }
+
+            // Divisão pela mediana com folhas de até 4: no máximo ~n/2 nós para n grande
+            nodes.reserve(instances.size() / 2 + 64);
+            nodes.push_back(node());
+            build_node(0, 0, static_cast<uint32_t>(instances.size()), boxes, order);
+            nodes.shrink_to_fit();
+            std::vector<aabb>().swap(boxes);
+
+            // Reordena no lugar seguindo os ciclos da permutação (sem uma segunda cópia da tabela)
+            for (uint32_t k = 0; k < order.size(); k++) {
+                if (order[k] == k) continue;
+                instance_record saved = instances[k];
+                uint32_t dst = k;
+                while (order[dst] != k) {
+                    uint32_t src = order[dst];
+                    instances[dst] = instances[src];
+                    order[dst] = dst;
+                    dst = src;
+                }
+                instances[dst] = saved;
+                order[dst] = dst;
+            }
+        }
+
+        virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override {
+            if (nodes.empty()) return false;
+
+            float org[3], inv_dir[3];
+            for (int a = 0; a < 3; a++) {
+                org[a] = static_cast<float>(r.orig[a]);
+                inv_dir[a] = static_cast<float>(1.0 / r.dir[a]);
+            }
+
+            uint32_t stack[64];
+            int sp = 0;
+            stack[sp++] = 0;
+
+            nearest best;
+            best.t = t_max;
+
+            while (sp > 0) {
+                const node& nd = nodes[stack[--sp]];
+                if (!nd.hit(org, inv_dir, static_cast<float>(t_min), static_cast<float>(best.t))) continue;
+
+                if (nd.count == 0) {
+                    stack[sp++] = nd.first + 1;
+                    stack[sp++] = nd.first;
+                    continue;
+                }
+                hit_instances(nd.first, nd.count, r, t_min, rec, best);
+            }
+
+            return finish_hit(r, rec, best);
+        }
+
+        // Faixa de instâncias de uma folha da BVH, com a caixa da folha no mundo
+        struct instance_range {
+            aabb box;
+            uint32_t first;
+            uint32_t count;
+        };
+
+        // Folhas cujas caixas passam em visible(aabb) (culling por tile, ver frustum.h).
+        // Para e devolve false se passarem de 'limit' folhas.
+        template <typename Visible>
+        bool collect_leaves(Visible visible, size_t limit, std::vector<instance_range>& out) const {
+            if (nodes.empty()) return true;
+            uint32_t stack[64];
+            int sp = 0;
+            stack[sp++] = 0;
+            while (sp > 0) {
+                const node& nd = nodes[stack[--sp]];
+                aabb box = nd.box();
+                if (!visible(box)) continue;
+                if (nd.count == 0) {
+                    stack[sp++] = nd.first + 1;
+                    stack[sp++] = nd.first;
+                    continue;
+                }
+                if (out.size() >= limit) return false;
+                out.push_back(instance_range{box, nd.first, nd.count});
+            }
+            return true;
+        }
+
+        // Interseção só com as instâncias da faixa (mesmo resultado de hit() restrito a elas)
+        bool hit_range(const instance_range& range, const ray& r, double t_min, double t_max, hit_record& rec) const {
+            nearest best;
+            best.t = t_max;
+            hit_instances(range.first, range.count, r, t_min, rec, best);
+            return finish_hit(r, rec, best);
+        }
+
+        virtual bool bounding_box(aabb& output_box) const override {
+            if (nodes.empty()) return false;
+            output_box = nodes[0].box();
+            return true;
+        }
+
+        size_t memory_bytes() const {
+            return instances.capacity() * sizeof(instance_record) + nodes.capacity() * sizeof(node);
+        }
+
+    private:
+        // Nó da BVH em float: folha se count > 0, senão filhos em first e first+1
+        struct node {
+            float bmin[3];
+            float bmax[3];
+            uint32_t first;
+            uint32_t count;
+
+            bool hit(const float* org, const float* inv_dir, float t_min, float t_max) const {
+                for (int a = 0; a < 3; a++) {
+                    float t0 = (bmin[a] - org[a]) * inv_dir[a];
+                    float t1 = (bmax[a] - org[a]) * inv_dir[a];
+                    if (inv_dir[a] < 0.0f) std::swap(t0, t1);
+                    t_min = t0 > t_min ? t0 : t_min;
+                    t_max = t1 < t_max ? t1 : t_max;
+                    if (t_max < t_min) return false;
+                }
+                return true;
+            }
+
+            aabb box() const {
+                return aabb(point3(bmin[0], bmin[1], bmin[2]), point3(bmax[0], bmax[1], bmax[2]));
+            }
+        };
+
+        // Instância mais próxima até agora e a inversa usada para chegar nela
+        struct nearest {
+            const instance_record* inst = nullptr;
+            affine3x4 inverse{};
+            double t = 0;
+        };
+
+        static const uint32_t leaf_size = 4;
+        std::vector<node> nodes;
+        std::vector<aabb> geometry_boxes; // Caixa local de cada geometria
+
+        void hit_instances(uint32_t first, uint32_t count, const ray& r, double t_min, hit_record& rec, nearest& best) const {
+            hit_record temp_rec;
+            for (uint32_t k = first; k < first + count; k++) {
+                const instance_record& inst = instances[k];
+                // Inversa derivada só aqui, quando o raio já chegou perto da instância
+                affine3x4 inv = inst.transform.inverse();
+                ray local(inv.apply_point(r.origin()), inv.apply_vector(r.direction()));
+                if (!geometry_boxes[inst.geometry].hit(local, t_min, best.t)) continue;
+                if (geometry[inst.geometry]->hit(local, t_min, best.t, temp_rec)) {
+                    best.t = temp_rec.t;
+                    rec = temp_rec;
+                    best.inst = &inst;
+                    best.inverse = inv;
+                }
+            }
+        }
+
+        // De volta ao mundo: o ponto pelo raio original e a normal pela transposta da inversa
+        // (correta também com escala não uniforme e cisalhamento)
+        bool finish_hit(const ray& r, hit_record& rec, const nearest& best) const {
+            if (!best.inst) return false;
+            rec.p = r.at(rec.t);
+            vec3 outward = best.inverse.apply_transposed(rec.front_face ? rec.normal : -rec.normal);
+            rec.set_face_normal(r, unit_vector(outward));
+            if (best.inst->material != no_override) rec.mat_ptr = materials[best.inst->material];
+            return true;
+        }
+
+        aabb world_box(const instance_record& inst) const {
+            const aabb& local = geometry_boxes[inst.geometry];
+            aabb box;
+            for (int i = 0; i < 8; i++) {
+                point3 corner((i & 1) ? local.maximum.x() : local.minimum.x(),
+                              (i & 2) ? local.maximum.y() : local.minimum.y(),
+                              (i & 4) ? local.maximum.z() : local.minimum.z());
+                point3 p = inst.transform.apply_point(corner);
+                box = surrounding_box(box, aabb(p, p));
+            }
+            return box;
+        }
+
+        void build_node(uint32_t n, uint32_t first, uint32_t count,
+                        const std::vector<aabb>& boxes, std::vector<uint32_t>& order) {
+            aabb box, centroid_box;
+            for (uint32_t k = first; k < first + count; k++) {
+                box = surrounding_box(box, boxes[order[k]]);
+                point3 c = boxes[order[k]].centroid();
+                centroid_box = surrounding_box(centroid_box, aabb(c, c));
+            }
+            // Arredonda para fora: a caixa em float nunca fica menor que a em double
+            for (int a = 0; a < 3; a++) {
+                nodes[n].bmin[a] = std::nextafter(static_cast<float>(box.minimum[a]), -INFINITY);
+                nodes[n].bmax[a] = std::nextafter(static_cast<float>(box.maximum[a]), INFINITY);
+            }
+
+            if (count <= leaf_size) {
+                nodes[n].first = first;
+                nodes[n].count = count;
+                return;
+            }
+
+            vec3 extent = centroid_box.maximum - centroid_box.minimum;
+            int axis = 0;
+            if (extent.y() > extent.x()) axis = 1;
+            if (extent.z() > extent[axis]) axis = 2;
+
+            uint32_t mid = first + count/2;
+            std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count,
+                             [&](uint32_t a, uint32_t b) {
+                                 return boxes[a].centroid()[axis] < boxes[b].centroid()[axis];
+                             });
+
+            uint32_t left = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(node());
+            nodes.push_back(node());
+            nodes[n].first = left;
+            nodes[n].count = 0;
+            build_node(left, first, mid - first, boxes, order);
+            build_node(left + 1, mid, first + count - mid, boxes, order);
+        }
+};
+
+#endif
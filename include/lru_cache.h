@@ -0,0 +1,108 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+using std::shared_ptr;
+
+// --- Cache LRU com teto de bytes ---
+//
+// Base dos caches de tiles de textura (image_texture.h) e de páginas de malha (paged_mesh.h).
+// 'ByteSize' diz quantos bytes um valor ocupa (size_t operator()(const Value&)); a cada entrada
+// soma-se ainda entry_overhead (lista, mapa e shared_ptr). Seguro entre threads.
+template <typename Key, typename Value, typename ByteSize>
+class lru_cache {
+    public:
+        size_t capacity_bytes;
+
+        // Contadores (desde a criação)
+        long hits = 0;
+        long misses = 0;
+        long evictions = 0;
+        size_t resident_bytes = 0;
+        size_t peak_bytes = 0;
+
+        explicit lru_cache(size_t max_bytes) : capacity_bytes(max_bytes) {}
+
+        // Devolve o valor 'key', chamando load() se ele não estiver no cache (nulo não é guardado).
+        // load() roda fora da trava; o shared_ptr devolvido continua válido mesmo se a entrada for despejada.
+        template <typename Loader>
+        shared_ptr<const Value> fetch(const Key& key, Loader load) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = entries.find(key);
+                if (it != entries.end()) {
+                    hits++;
+                    lru.splice(lru.begin(), lru, it->second.position);
+                    return it->second.value;
+                }
+                misses++;
+            }
+
+            shared_ptr<const Value> value = load();
+            if (!value) return value;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end()) return it->second.value; // Outra thread carregou a mesma chave antes
+            lru.push_front(key);
+            size_t bytes = ByteSize()(*value) + entry_overhead;
+            entries.emplace(key, entry{value, bytes, lru.begin()});
+            resident_bytes += bytes;
+            evict_to(capacity_bytes);
+            peak_bytes = std::max(peak_bytes, resident_bytes);
+            return value;
+        }
+
+        void set_capacity(size_t bytes) {
+            std::lock_guard<std::mutex> lock(mutex);
+            capacity_bytes = bytes;
+            evict_to(capacity_bytes);
+        }
+
+    protected:
+        // Lista, mapa e shared_ptr por entrada
+        static const size_t entry_overhead = 96;
+
+        mutable std::mutex mutex;
+
+        // "<titulo>: N <unidade>, X MB (pico, teto), acertos, <faltas> M, despejos"
+        void print_counters(std::ostream& out, const char* title, const char* unit, const char* miss_name) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            long lookups = hits + misses;
+            out << title << ": " << entries.size() << ' ' << unit << ", "
+                << resident_bytes / (1024.0 * 1024.0) << " MB (pico " << peak_bytes / (1024.0 * 1024.0)
+                << " MB, teto " << capacity_bytes / (1024.0 * 1024.0) << " MB), acertos "
+                << (lookups > 0 ? 100.0 * hits / lookups : 0.0) << "%, " << miss_name << ' ' << misses
+                << ", despejos " << evictions << "\n";
+        }
+
+    private:
+        struct entry {
+            shared_ptr<const Value> value;
+            size_t bytes;
+            typename std::list<Key>::iterator position;
+        };
+
+        std::list<Key> lru; // Frente = usado mais recentemente
+        std::unordered_map<Key, entry> entries;
+
+        // Despeja do fim da lista até caber no teto (a entrada mais recente sempre fica)
+        void evict_to(size_t limit) {
+            while (resident_bytes > limit && entries.size() > 1) {
+                auto it = entries.find(lru.back());
+                resident_bytes -= it->second.bytes;
+                entries.erase(it);
+                lru.pop_back();
+                evictions++;
+            }
+        }
+};
+
+#endif
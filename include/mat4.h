@@ -4,6 +4,7 @@
 #include "vec4.h"
 #include <cmath>
 #include <iostream>
+#include <utility>
 
 class mat4 {
     public:
@@ -72,6 +73,22 @@ class mat4 {
             return mat;
         }
 
+        // 4. Matriz de Rotação em torno de um Eixo Arbitrário (Fórmula de Rodrigues)
+        // A inversa é a mesma rotação com ângulo negativo.
+        static mat4 rotate(const vec3& axis, double angle_radians) {
+            mat4 mat;
+            double len = axis.length();
+            if (len < 1e-12) return mat;
+            double x = axis.x()/len, y = axis.y()/len, z = axis.z()/len;
+            double c = cos(angle_radians);
+            double s = sin(angle_radians);
+            double t = 1 - c;
+            mat[0][0] = t*x*x + c;   mat[0][1] = t*x*y - s*z; mat[0][2] = t*x*z + s*y;
+            mat[1][0] = t*x*y + s*z; mat[1][1] = t*y*y + c;   mat[1][2] = t*y*z - s*x;
+            mat[2][0] = t*x*z - s*y; mat[2][1] = t*y*z + s*x; mat[2][2] = t*z*z + c;
+            return mat;
+        }
+
         // --- Operações Algébricas ---
 
         // Multiplicação Matriz x Matriz (Combina transformações)
@@ -101,6 +118,15 @@ class mat4 {
             return vec4(res[0], res[1], res[2], res[3]);
         }
 
+        // Transposta (a transposta da inversa leva normais para o mundo, ver instance.h)
+        mat4 transpose() const {
+            mat4 result;
+            for(int i=0; i<4; i++)
+                for(int j=0; j<4; j++)
+                    result[i][j] = m[j][i];
+            return result;
+        }
+
         static mat4 reflection(bool reflect_x, bool reflect_y, bool reflect_z) {
             mat4 mat; // Identidade
             if (reflect_x) mat[0][0] = -1;
@@ -109,12 +135,46 @@ class mat4 {
             return mat;
         }
         
-        // Inversa (Simplificada ou Geral)
+        // Inversa Geral (Gauss-Jordan com pivoteamento parcial)
         // Para Ray Tracing, precisamos da inversa para trazer o Raio do Mundo para o Espaço do Objeto.
-        // Implementar a inversa completa de 4x4 é complexo (Gauss-Jordan), 
-        // mas para transformações afins básicas, podemos expandir depois se necessário.
-        // Por enquanto, vamos assumir que o usuário usará bibliotecas ou implementará se precisar de cisalhamento complexo.
-        // Dica: Para Rotação+Translação, a inversa é fácil calcular separadamente.
+        // Quando a inversa é conhecida analiticamente (ex: Rotação+Translação), prefira montá-la direto,
+        // que é mais barato e exato; esta versão serve para composições quaisquer (ex: cisalhamento).
+        mat4 inverse() const {
+            double a[4][8];
+            for(int i=0; i<4; i++) {
+                for(int j=0; j<4; j++) {
+                    a[i][j] = m[i][j];
+                    a[i][j+4] = (i == j) ? 1.0 : 0.0;
+                }
+            }
+
+            for(int col=0; col<4; col++) {
+                // Escolhe a linha com o maior pivô (estabilidade numérica)
+                int pivot = col;
+                for(int i=col+1; i<4; i++)
+                    if (fabs(a[i][col]) > fabs(a[pivot][col])) pivot = i;
+                if (fabs(a[pivot][col]) < 1e-12) return mat4(); // Singular: devolve identidade
+
+                if (pivot != col)
+                    for(int j=0; j<8; j++) std::swap(a[col][j], a[pivot][j]);
+
+                double inv_p = 1.0 / a[col][col];
+                for(int j=0; j<8; j++) a[col][j] *= inv_p;
+
+                for(int i=0; i<4; i++) {
+                    if (i == col) continue;
+                    double f = a[i][col];
+                    if (f == 0.0) continue;
+                    for(int j=0; j<8; j++) a[i][j] -= f * a[col][j];
+                }
+            }
+
+            mat4 result;
+            for(int i=0; i<4; i++)
+                for(int j=0; j<4; j++)
+                    result[i][j] = a[i][j+4];
+            return result;
+        }
 };
 
 #endif
\ No newline at end of file
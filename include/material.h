@@ -12,6 +12,9 @@ class material {
         vec3 ks;                // Cor Especular (O brilho branco/colorido da luz)
         double ka;              // Coeficiente Ambiental (quanto ele "brilha" no escuro)
         double shininess;       // Brilho (Ex: 32 para plástico, 200 para metal)
+        color kr = color(0,0,0);  // Refletividade (espelho; colorida para metais como ouro)
+        color kt = color(0,0,0);  // Transmissão (vidro, água)
+        double ior = 1.5;         // Índice de refração (usado quando kt > 0)
 
         // Construtor Simples (Cor sólida)
         material(color color_diffuse, double k_ambient=0.1, double k_shine=30.0, vec3 color_spec=vec3(1,1,1))
@@ -20,6 +23,14 @@ class material {
         // Construtor Textura
         material(shared_ptr<texture> texture_diffuse, double k_ambient=0.1, double k_shine=30.0, vec3 color_spec=vec3(1,1,1))
             : kd(texture_diffuse), ks(color_spec), ka(k_ambient), shininess(k_shine) {}
+
+        bool is_reflective() const { return kr.x() > 0 || kr.y() > 0 || kr.z() > 0; }
+        bool is_transparent() const { return kt.x() > 0 || kt.y() > 0 || kt.z() > 0; }
+
+        // Fração que sobra para a difusa (o que é refletido ou transmitido não se espalha)
+        color diffuse_weight() const {
+            return color(fmax(0.0, 1 - kr.x() - kt.x()), fmax(0.0, 1 - kr.y() - kt.y()), fmax(0.0, 1 - kr.z() - kt.z()));
+        }
 };
 
 #endif
\ No newline at end of file
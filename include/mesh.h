@@ -3,6 +3,11 @@
 
 #include "hittable.h"
 #include "hittable_list.h"
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 
 // Triângulo Individual
 class triangle : public hittable {
@@ -38,15 +43,229 @@ class triangle : public hittable {
             rec.p = r.at(t);
             vec3 normal = unit_vector(cross(v0v1, v0v2));
             rec.set_face_normal(r, normal);
-            rec.mat_ptr = mat_ptr;
+            rec.mat_ptr = mat_ptr.get();
             rec.u = u;
             rec.v = v;
             return true;
         }
+
+        virtual bool bounding_box(aabb& output_box) const override {
+            // Pequena folga: faces alinhadas aos eixos teriam caixa de espessura zero
+            const double pad = 1e-4;
+            output_box = aabb(
+                point3(fmin(v0.x(), fmin(v1.x(), v2.x())) - pad,
+                       fmin(v0.y(), fmin(v1.y(), v2.y())) - pad,
+                       fmin(v0.z(), fmin(v1.z(), v2.z())) - pad),
+                point3(fmax(v0.x(), fmax(v1.x(), v2.x())) + pad,
+                       fmax(v0.y(), fmax(v1.y(), v2.y())) + pad,
+                       fmax(v0.z(), fmax(v1.z(), v2.z())) + pad));
+            return true;
+        }
 };
 
-// Caixa completa (6 faces, 12 triângulos)
-class box_mesh : public hittable_list {
+// Face indexada: 3 índices de vértice + handle do material (16 bytes, sem ponteiros)
+struct mesh_face {
+    uint32_t v[3];
+    uint32_t material;
+};
+
+// Malha de Triângulos Compacta
+// Vértices e faces ficam em vetores contíguos e as faces referenciam materiais por handle
+// de 32 bits, em vez de um objeto 'triangle' (com shared_ptr) por face no heap.
+// Uma BVH interna sobre as faces evita testar todos os triângulos a cada raio.
+class triangle_mesh : public hittable {
+    public:
+        std::vector<point3> vertices;
+        std::vector<mesh_face> faces;
+        handle_table<material> materials;
+
+        uint32_t add_vertex(const point3& p) {
+            vertices.push_back(p);
+            return static_cast<uint32_t>(vertices.size() - 1);
+        }
+
+        uint32_t add_material(shared_ptr<material> m) { return materials.add(m); }
+
+        void add_face(uint32_t a, uint32_t b, uint32_t c, uint32_t material_handle) {
+            faces.push_back(mesh_face{{a, b, c}, material_handle});
+        }
+
+        // Monta a BVH das faces (chamar depois de adicionar todas). Reordena 'faces'.
+        void build() {
+            nodes.clear();
+            if (faces.empty()) return;
+
+            // Caixas e centróides calculados uma vez; o build ordena só os índices
+            order.resize(faces.size());
+            boxes.resize(faces.size());
+            centroids.resize(faces.size());
+            for (uint32_t f = 0; f < faces.size(); f++) {
+                order[f] = f;
+                boxes[f] = face_box(faces[f]);
+                centroids[f] = boxes[f].centroid();
+            }
+
+            nodes.reserve(2 * faces.size() / leaf_size + 1);
+            nodes.push_back(node());
+            build_node(0, 0, static_cast<uint32_t>(faces.size()));
+
+            // Reordena as faces para que cada folha seja uma faixa contígua
+            std::vector<mesh_face> sorted(faces.size());
+            for (size_t k = 0; k < faces.size(); k++) sorted[k] = faces[order[k]];
+            faces.swap(sorted);
+            std::vector<uint32_t>().swap(order);
+            std::vector<aabb>().swap(boxes);
+            std::vector<point3>().swap(centroids);
+        }
+
+        virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override {
+            if (nodes.empty()) return false;
+
+            vec3 d = r.direction();
+            vec3 inv_dir(1.0/d.x(), 1.0/d.y(), 1.0/d.z());
+            uint32_t stack[64];
+            int sp = 0;
+            stack[sp++] = 0;
+
+            const mesh_face* best = nullptr;
+            double best_t = t_max, best_u = 0, best_v = 0;
+
+            while (sp > 0) {
+                const node& nd = nodes[stack[--sp]];
+                if (!nd.box.hit(r, inv_dir, t_min, best_t)) continue;
+
+                if (nd.count > 0) {
+                    for (uint32_t f = nd.first; f < nd.first + nd.count; f++) {
+                        double t, u, v;
+                        if (intersect(faces[f], r, t_min, best_t, t, u, v)) {
+                            best = &faces[f];
+                            best_t = t;
+                            best_u = u;
+                            best_v = v;
+                        }
+                    }
+                } else {
+                    stack[sp++] = nd.first + 1; // Filho direito
+                    stack[sp++] = nd.first;     // Filho esquerdo (visitado primeiro)
+                }
+            }
+
+            if (!best) return false;
+
+            // Só o triângulo mais próximo preenche o hit_record
+            const point3& v0 = vertices[best->v[0]];
+            vec3 normal = unit_vector(cross(vertices[best->v[1]] - v0, vertices[best->v[2]] - v0));
+            rec.t = best_t;
+            rec.p = r.at(best_t);
+            rec.set_face_normal(r, normal);
+            rec.mat_ptr = materials[best->material];
+            rec.u = best_u;
+            rec.v = best_v;
+            return true;
+        }
+
+        virtual bool bounding_box(aabb& output_box) const override {
+            if (nodes.empty()) return false;
+            output_box = nodes[0].box;
+            return true;
+        }
+
+        // Memória da malha (vértices + faces + BVH)
+        size_t memory_bytes() const {
+            return vertices.size() * sizeof(point3) + faces.size() * sizeof(mesh_face) + nodes.size() * sizeof(node);
+        }
+
+    private:
+        // Nó da BVH: folha se count > 0 (faces [first, first+count)),
+        // senão os filhos ficam em first e first+1
+        struct node {
+            aabb box;
+            uint32_t first = 0;
+            uint32_t count = 0;
+        };
+
+        static const uint32_t leaf_size = 4;
+        std::vector<node> nodes;
+
+        // Temporários do build
+        std::vector<uint32_t> order;
+        std::vector<aabb> boxes;
+        std::vector<point3> centroids;
+
+        aabb face_box(const mesh_face& f) const {
+            const double pad = 1e-4; // Faces alinhadas aos eixos teriam caixa de espessura zero
+            const point3& a = vertices[f.v[0]];
+            const point3& b = vertices[f.v[1]];
+            const point3& c = vertices[f.v[2]];
+            return aabb(point3(fmin(a.x(), fmin(b.x(), c.x())) - pad,
+                               fmin(a.y(), fmin(b.y(), c.y())) - pad,
+                               fmin(a.z(), fmin(b.z(), c.z())) - pad),
+                        point3(fmax(a.x(), fmax(b.x(), c.x())) + pad,
+                               fmax(a.y(), fmax(b.y(), c.y())) + pad,
+                               fmax(a.z(), fmax(b.z(), c.z())) + pad));
+        }
+
+        void build_node(uint32_t n, uint32_t first, uint32_t count) {
+            aabb box, centroid_box;
+            for (uint32_t k = first; k < first + count; k++) {
+                box = surrounding_box(box, boxes[order[k]]);
+                const point3& c = centroids[order[k]];
+                centroid_box = surrounding_box(centroid_box, aabb(c, c));
+            }
+            nodes[n].box = box;
+
+            if (count <= leaf_size) {
+                nodes[n].first = first;
+                nodes[n].count = count;
+                return;
+            }
+
+            vec3 extent = centroid_box.maximum - centroid_box.minimum;
+            int axis = 0;
+            if (extent.y() > extent.x()) axis = 1;
+            if (extent.z() > extent[axis]) axis = 2;
+
+            uint32_t mid = first + count/2;
+            std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count,
+                             [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+
+            // Filhos lado a lado no vetor (um índice só no nó)
+            uint32_t left = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(node());
+            nodes.push_back(node());
+            nodes[n].first = left;
+            nodes[n].count = 0;
+            build_node(left, first, mid - first);
+            build_node(left + 1, mid, first + count - mid);
+        }
+
+        // Möller–Trumbore (mesmo teste de triangle::hit, sem preencher o hit_record)
+        bool intersect(const mesh_face& f, const ray& r, double t_min, double t_max,
+                       double& t, double& u, double& v) const {
+            const point3& v0 = vertices[f.v[0]];
+            vec3 v0v1 = vertices[f.v[1]] - v0;
+            vec3 v0v2 = vertices[f.v[2]] - v0;
+            vec3 pvec = cross(r.direction(), v0v2);
+            double det = dot(v0v1, pvec);
+
+            if (fabs(det) < 1e-8) return false;
+            double invDet = 1.0 / det;
+
+            vec3 tvec = r.origin() - v0;
+            u = dot(tvec, pvec) * invDet;
+            if (u < 0 || u > 1) return false;
+
+            vec3 qvec = cross(tvec, v0v1);
+            v = dot(r.direction(), qvec) * invDet;
+            if (v < 0 || u + v > 1) return false;
+
+            t = dot(v0v2, qvec) * invDet;
+            return t >= t_min && t <= t_max;
+        }
+};
+
+// Caixa completa (6 faces, 12 triângulos) sobre 8 vértices compartilhados
+class box_mesh : public triangle_mesh {
     public:
         box_mesh(const point3& p0, const point3& p1, shared_ptr<material> ptr) {
             point3 min = point3(fmin(p0.x(), p1.x()), fmin(p0.y(), p1.y()), fmin(p0.z(), p1.z()));
@@ -56,30 +275,43 @@ class box_mesh : public hittable_list {
             vec3 dy(0, max.y()-min.y(), 0);
             vec3 dz(0, 0, max.z()-min.z());
 
+            // Cantos: o = min, e as somas de dx, dy, dz
+            uint32_t o   = add_vertex(min);
+            uint32_t x   = add_vertex(min+dx);
+            uint32_t y   = add_vertex(min+dy);
+            uint32_t z   = add_vertex(min+dz);
+            uint32_t xy  = add_vertex(min+dx+dy);
+            uint32_t xz  = add_vertex(min+dx+dz);
+            uint32_t yz  = add_vertex(min+dy+dz);
+            uint32_t xyz = add_vertex(min+dx+dy+dz);
+            uint32_t m = add_material(ptr);
+
             // Frente (Z normal +)
-            add(make_shared<triangle>(min,           min+dx,      min+dy,      ptr));
-            add(make_shared<triangle>(min+dx,        min+dx+dy,   min+dy,      ptr));
+            add_face(o,  x,   y,   m);
+            add_face(x,  xy,  y,   m);
 
             // Trás (Z normal -)
-            add(make_shared<triangle>(min+dx+dz,     min+dz,      min+dx+dy+dz, ptr));
-            add(make_shared<triangle>(min+dz,        min+dy+dz,   min+dx+dy+dz, ptr));
+            add_face(xz, z,   xyz, m);
+            add_face(z,  yz,  xyz, m);
 
             // Topo (Y normal +)
-            add(make_shared<triangle>(min+dy,        min+dy+dx,   min+dy+dz,    ptr));
-            add(make_shared<triangle>(min+dy+dx,     min+dy+dx+dz,min+dy+dz,    ptr));
+            add_face(y,  xy,  yz,  m);
+            add_face(xy, xyz, yz,  m);
 
             // Fundo (Y normal -)
-            add(make_shared<triangle>(min,           min+dz,      min+dx,       ptr));
-            add(make_shared<triangle>(min+dx,        min+dz,      min+dx+dz,    ptr));
+            add_face(o,  z,   x,   m);
+            add_face(x,  z,   xz,  m);
 
             // Esquerda (X normal -)
-            add(make_shared<triangle>(min,           min+dy,      min+dz,       ptr));
-            add(make_shared<triangle>(min+dz,        min+dy,      min+dy+dz,    ptr));
+            add_face(o,  y,   z,   m);
+            add_face(z,  y,   yz,  m);
 
             // Direita (X normal +)
-            add(make_shared<triangle>(min+dx+dz,     min+dy+dx+dz, min+dx,      ptr));
-            add(make_shared<triangle>(min+dx,        min+dy+dx+dz, min+dy+dx,   ptr));
+            add_face(xz, xyz, x,   m);
+            add_face(x,  xyz, xy,  m);
+
+            build();
         }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,658 @@
+#ifndef PAGED_MESH_H
+#define PAGED_MESH_H
+
+#include "utils.h"
+#include "hittable.h"
+#include "mesh.h"
+#include "arena.h"
+#include "lru_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// --- Malhas Fora da Memória (páginas mapeadas sob demanda) ---
+//
+// Malhas escaneadas com dezenas de milhões de triângulos não cabem como triangle_mesh (vértices,
+// faces e BVH inteiros no heap). write_paged_mesh() converte uma malha para um arquivo em páginas:
+//   - As faces são agrupadas espacialmente (divisão pela mediana dos centróides, como a BVH) em
+//     páginas de até 'page_faces' triângulos, gravadas na ordem da divisão (vizinhas no espaço
+//     ficam vizinhas no disco).
+//   - Cada página é autossuficiente: caixa, BVH local (nós com caixas em float), vértices locais
+//     em float e faces com índices locais. Nada nela precisa ser convertido ao ser lida.
+// paged_mesh abre o arquivo, lê só a tabela de páginas (48 bytes por página) e monta na memória
+// uma BVH pequena sobre as caixas das páginas. O percurso de um raio visita as páginas da mais
+// próxima para a mais distante e só mapeia (mmap) as que o raio realmente atinge; as páginas
+// mapeadas ficam num cache LRU com teto de bytes (o conjunto residente), compartilhável por
+// várias malhas. Faltas e despejos são contados para ajustar o teto e o tamanho das páginas.
+// Sem mmap (Windows) a página é lida para o heap.
+
+struct paged_mesh_header {
+    char magic[4];           // "RTPM"
+    uint32_t version;
+    uint32_t page_count;
+    uint32_t material_count; // Maior handle de material usado + 1
+    uint64_t face_count;
+};
+
+// Entrada da tabela de páginas (logo depois do cabeçalho)
+struct paged_mesh_page_entry {
+    float minimum[3];
+    float maximum[3];
+    uint64_t offset;         // Alinhado a 4096 (mmap direto)
+    uint32_t bytes;
+    uint32_t node_count;
+    uint32_t vertex_count;
+    uint32_t face_count;
+};
+
+// Nó da BVH de uma página: folha se count > 0 (faces [first, first+count)), senão filhos em
+// first e first+1 (mesmo layout de triangle_mesh)
+struct paged_mesh_node {
+    float minimum[3];
+    float maximum[3];
+    uint32_t first;
+    uint32_t count;
+};
+
+static const uint32_t paged_mesh_version = 1;
+static const uint64_t paged_mesh_alignment = 4096;
+
+// Página residente: ponteiros para dentro do mapeamento (ou do buffer lido)
+struct mesh_page {
+    const paged_mesh_node* nodes = nullptr;
+    const float* vertices = nullptr;  // x, y, z por vértice
+    const mesh_face* faces = nullptr;
+    size_t bytes = 0;
+
+    void* mapping = nullptr;
+    size_t mapping_length = 0;
+
+    mesh_page() = default;
+    mesh_page(const mesh_page&) = delete;
+    mesh_page& operator=(const mesh_page&) = delete;
+
+    ~mesh_page() {
+        if (!mapping) return;
+#ifndef _WIN32
+        munmap(mapping, mapping_length);
+#else
+        std::free(mapping);
+#endif
+    }
+};
+
+struct mesh_page_bytes {
+    size_t operator()(const mesh_page& page) const { return page.bytes + sizeof(mesh_page); }
+};
+
+// Cache LRU de páginas com teto de bytes (o conjunto residente), compartilhado por várias paged_mesh.
+// Uma falta (misses) mapeia a página do disco; o mapeamento continua válido enquanto houver shared_ptr.
+class mesh_page_cache : public lru_cache<uint64_t, mesh_page, mesh_page_bytes> {
+    public:
+        explicit mesh_page_cache(size_t max_bytes = size_t(512) << 20) : lru_cache(max_bytes) {}
+
+        uint32_t register_mesh() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return next_mesh++;
+        }
+
+        void print(std::ostream& out) const { print_counters(out, "Paginas de malha", "residentes", "faltas"); }
+
+    private:
+        uint32_t next_mesh = 0;
+};
+
+// --- Conversão para o formato em páginas ---
+
+// Ordena order[first, first+count) pela mediana dos centróides no eixo de maior extensão e
+// devolve a posição do corte
+inline uint32_t split_by_centroid(std::vector<uint32_t>& order, const std::vector<point3>& centroids,
+                                  uint32_t first, uint32_t count) {
+    aabb centroid_box;
+    for (uint32_t k = first; k < first + count; k++) {
+        const point3& c = centroids[order[k]];
+        centroid_box = surrounding_box(centroid_box, aabb(c, c));
+    }
+    vec3 extent = centroid_box.maximum - centroid_box.minimum;
+    int axis = 0;
+    if (extent.y() > extent.x()) axis = 1;
+    if (extent.z() > extent[axis]) axis = 2;
+
+    uint32_t mid = first + count/2;
+    std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count,
+                     [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+    return mid;
+}
+
+// Caixa em float arredondada para fora (nunca menor que a caixa em double)
+inline void store_box(const aabb& box, float* minimum, float* maximum) {
+    for (int a = 0; a < 3; a++) {
+        minimum[a] = std::nextafter(static_cast<float>(box.minimum[a]), -std::numeric_limits<float>::infinity());
+        maximum[a] = std::nextafter(static_cast<float>(box.maximum[a]), std::numeric_limits<float>::infinity());
+    }
+}
+
+// Posiciona o arquivo com offset de 64 bits (o arquivo passa de 2 GB; long tem 32 bits no Windows)
+inline bool paged_mesh_seek(FILE* f, uint64_t offset) {
+#ifndef _WIN32
+    return fseeko(f, static_cast<off_t>(offset), SEEK_SET) == 0;
+#else
+    return _fseeki64(f, static_cast<long long>(offset), SEEK_SET) == 0;
+#endif
+}
+
+// Página em construção: vértices e faces locais + BVH
+class paged_mesh_page_builder {
+    public:
+        std::vector<paged_mesh_node> nodes;
+        std::vector<float> vertices;
+        std::vector<mesh_face> faces;
+
+        void build(const std::vector<point3>& src_vertices, const std::vector<mesh_face>& src_faces,
+                   const uint32_t* face_ids, uint32_t count) {
+            nodes.clear();
+            vertices.clear();
+            faces.clear();
+            std::unordered_map<uint32_t, uint32_t> local;
+            for (uint32_t k = 0; k < count; k++) {
+                mesh_face f = src_faces[face_ids[k]];
+                for (int c = 0; c < 3; c++) {
+                    auto it = local.find(f.v[c]);
+                    if (it == local.end()) {
+                        it = local.emplace(f.v[c], static_cast<uint32_t>(vertices.size() / 3)).first;
+                        const point3& p = src_vertices[f.v[c]];
+                        vertices.push_back(static_cast<float>(p.x()));
+                        vertices.push_back(static_cast<float>(p.y()));
+                        vertices.push_back(static_cast<float>(p.z()));
+                    }
+                    f.v[c] = it->second;
+                }
+                faces.push_back(f);
+            }
+
+            // Caixas a partir dos vértices já em float (os que o percurso vai testar)
+            order.resize(count);
+            boxes.resize(count);
+            centroids.resize(count);
+            for (uint32_t k = 0; k < count; k++) {
+                order[k] = k;
+                boxes[k] = face_box(faces[k]);
+                centroids[k] = boxes[k].centroid();
+            }
+            nodes.reserve(2 * count / leaf_size + 1);
+            nodes.push_back(paged_mesh_node());
+            build_node(0, 0, count);
+
+            std::vector<mesh_face> sorted(count);
+            for (uint32_t k = 0; k < count; k++) sorted[k] = faces[order[k]];
+            faces.swap(sorted);
+        }
+
+        aabb bounds() const {
+            const paged_mesh_node& root = nodes[0];
+            return aabb(point3(root.minimum[0], root.minimum[1], root.minimum[2]),
+                        point3(root.maximum[0], root.maximum[1], root.maximum[2]));
+        }
+
+        size_t bytes() const {
+            return nodes.size() * sizeof(paged_mesh_node) + vertices.size() * sizeof(float) + faces.size() * sizeof(mesh_face);
+        }
+
+    private:
+        static const uint32_t leaf_size = 4;
+        std::vector<uint32_t> order;
+        std::vector<aabb> boxes;
+        std::vector<point3> centroids;
+
+        point3 vertex(uint32_t i) const { return point3(vertices[3*i], vertices[3*i + 1], vertices[3*i + 2]); }
+
+        aabb face_box(const mesh_face& f) const {
+            const double pad = 1e-4; // Faces alinhadas aos eixos teriam caixa de espessura zero
+            point3 a = vertex(f.v[0]), b = vertex(f.v[1]), c = vertex(f.v[2]);
+            return aabb(point3(fmin(a.x(), fmin(b.x(), c.x())) - pad,
+                               fmin(a.y(), fmin(b.y(), c.y())) - pad,
+                               fmin(a.z(), fmin(b.z(), c.z())) - pad),
+                        point3(fmax(a.x(), fmax(b.x(), c.x())) + pad,
+                               fmax(a.y(), fmax(b.y(), c.y())) + pad,
+                               fmax(a.z(), fmax(b.z(), c.z())) + pad));
+        }
+
+        void build_node(uint32_t n, uint32_t first, uint32_t count) {
+            aabb box;
+            for (uint32_t k = first; k < first + count; k++) box = surrounding_box(box, boxes[order[k]]);
+            store_box(box, nodes[n].minimum, nodes[n].maximum);
+
+            if (count <= leaf_size) {
+                nodes[n].first = first;
+                nodes[n].count = count;
+                return;
+            }
+
+            uint32_t mid = split_by_centroid(order, centroids, first, count);
+            uint32_t left = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(paged_mesh_node());
+            nodes.push_back(paged_mesh_node());
+            nodes[n].first = left;
+            nodes[n].count = 0;
+            build_node(left, first, mid - first);
+            build_node(left + 1, mid, first + count - mid);
+        }
+};
+
+// Agrupa as faces em páginas de até 'page_faces' triângulos e grava o arquivo.
+// A conversão ainda lê a malha de origem inteira (vértices + faces); só o render é fora da memória.
+inline bool write_paged_mesh(const char* path, const std::vector<point3>& vertices,
+                             const std::vector<mesh_face>& faces, uint32_t page_faces = 4096) {
+    if (faces.empty() || page_faces == 0) return false;
+
+    uint32_t n = static_cast<uint32_t>(faces.size());
+    std::vector<uint32_t> order(n);
+    std::vector<point3> centroids(n);
+    uint32_t material_count = 0;
+    for (uint32_t f = 0; f < n; f++) {
+        order[f] = f;
+        const mesh_face& face = faces[f];
+        centroids[f] = (vertices[face.v[0]] + vertices[face.v[1]] + vertices[face.v[2]]) / 3.0;
+        material_count = std::max(material_count, face.material + 1);
+    }
+
+    // Faixas de 'order' que viram páginas, na ordem de um percurso em profundidade
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    std::vector<std::pair<uint32_t, uint32_t>> pending{{0, n}};
+    while (!pending.empty()) {
+        auto range = pending.back();
+        pending.pop_back();
+        if (range.second <= page_faces) {
+            ranges.push_back(range);
+            continue;
+        }
+        uint32_t mid = split_by_centroid(order, centroids, range.first, range.second);
+        pending.push_back({mid, range.first + range.second - mid});
+        pending.push_back({range.first, mid - range.first});
+    }
+    std::vector<point3>().swap(centroids);
+
+    FILE* out = std::fopen(path, "wb");
+    if (!out) return false;
+
+    paged_mesh_header header;
+    std::memcpy(header.magic, "RTPM", 4);
+    header.version = paged_mesh_version;
+    header.page_count = static_cast<uint32_t>(ranges.size());
+    header.material_count = material_count;
+    header.face_count = n;
+    std::vector<paged_mesh_page_entry> table(ranges.size());
+
+    // Tabela gravada no fim, quando os offsets são conhecidos
+    uint64_t position = sizeof(header) + table.size() * sizeof(paged_mesh_page_entry);
+    bool ok = true;
+    paged_mesh_page_builder page;
+    std::vector<char> padding(paged_mesh_alignment, 0);
+    for (size_t p = 0; p < ranges.size() && ok; p++) {
+        page.build(vertices, faces, order.data() + ranges[p].first, ranges[p].second);
+
+        uint64_t aligned = (position + paged_mesh_alignment - 1) & ~(paged_mesh_alignment - 1);
+        ok = paged_mesh_seek(out, position)
+          && std::fwrite(padding.data(), 1, aligned - position, out) == aligned - position
+          && std::fwrite(page.nodes.data(), sizeof(paged_mesh_node), page.nodes.size(), out) == page.nodes.size()
+          && std::fwrite(page.vertices.data(), sizeof(float), page.vertices.size(), out) == page.vertices.size()
+          && std::fwrite(page.faces.data(), sizeof(mesh_face), page.faces.size(), out) == page.faces.size();
+
+        paged_mesh_page_entry& e = table[p];
+        store_box(page.bounds(), e.minimum, e.maximum);
+        e.offset = aligned;
+        e.bytes = static_cast<uint32_t>(page.bytes());
+        e.node_count = static_cast<uint32_t>(page.nodes.size());
+        e.vertex_count = static_cast<uint32_t>(page.vertices.size() / 3);
+        e.face_count = static_cast<uint32_t>(page.faces.size());
+        position = aligned + e.bytes;
+    }
+
+    ok = ok && paged_mesh_seek(out, 0)
+            && std::fwrite(&header, sizeof(header), 1, out) == 1
+            && std::fwrite(table.data(), sizeof(paged_mesh_page_entry), table.size(), out) == table.size();
+    ok = std::fclose(out) == 0 && ok;
+    return ok;
+}
+
+// --- Leitura e interseção ---
+
+class paged_mesh : public hittable {
+    public:
+        handle_table<material> materials; // Mesma ordem dos handles da conversão (ver materials_needed)
+
+        explicit paged_mesh(shared_ptr<mesh_page_cache> page_cache)
+            : cache(page_cache), id(page_cache->register_mesh()) {}
+
+        ~paged_mesh() { close(); }
+
+        paged_mesh(const paged_mesh&) = delete;
+        paged_mesh& operator=(const paged_mesh&) = delete;
+
+        // Lê o cabeçalho e a tabela de páginas. Retorna false se o arquivo não existir ou não for
+        // uma malha em páginas desta versão.
+        bool open(const char* path) {
+            close();
+            FILE* in = std::fopen(path, "rb");
+            if (!in) return false;
+
+            paged_mesh_header header;
+            bool ok = std::fread(&header, sizeof(header), 1, in) == 1
+                   && std::memcmp(header.magic, "RTPM", 4) == 0
+                   && header.version == paged_mesh_version
+                   && header.page_count > 0;
+            if (ok) {
+                pages.resize(header.page_count);
+                ok = std::fread(pages.data(), sizeof(paged_mesh_page_entry), pages.size(), in) == pages.size();
+            }
+            if (!ok) {
+                std::fclose(in);
+                pages.clear();
+                return false;
+            }
+            material_count = header.material_count;
+            face_count = header.face_count;
+#ifndef _WIN32
+            fd = ::dup(fileno(in));
+            std::fclose(in);
+            if (fd < 0) {
+                pages.clear();
+                return false;
+            }
+#else
+            file = in;
+#endif
+            build_top();
+            return true;
+        }
+
+        bool loaded() const { return !top.empty(); }
+        size_t page_count() const { return pages.size(); }
+        uint64_t faces() const { return face_count; }
+        uint32_t materials_needed() const { return material_count; }
+
+        // Bytes de todas as páginas no disco (o que um triangle_mesh equivalente teria no heap)
+        uint64_t page_bytes() const {
+            uint64_t total = 0;
+            for (const auto& e : pages) total += e.bytes;
+            return total;
+        }
+
+        // Memória fixa (tabela de páginas + BVH das páginas); as páginas contam no cache
+        size_t memory_bytes() const {
+            return pages.size() * sizeof(paged_mesh_page_entry) + top.size() * sizeof(top_node);
+        }
+
+        virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override {
+            if (top.empty()) return false;
+
+            vec3 d = r.direction();
+            vec3 inv_dir(1.0/d.x(), 1.0/d.y(), 1.0/d.z());
+            // Nó e a distância de entrada na caixa dele (medida quando foi empilhado)
+            struct pending {
+                uint32_t node;
+                double t_enter;
+            };
+            pending stack[64];
+            int sp = 0;
+
+            nearest best;
+            best.t = t_max;
+            double t_root;
+            if (!enter(top[0].box, r, inv_dir, t_min, t_max, t_root)) return false;
+            stack[sp++] = pending{0, t_root};
+
+            while (sp > 0) {
+                pending item = stack[--sp];
+                // Empilhado antes do acerto atual e começa depois dele: nem é mapeado
+                if (item.t_enter > best.t) continue;
+                const top_node& nd = top[item.node];
+                if (nd.count > 0) {
+                    // Folha: uma página
+                    shared_ptr<const mesh_page> page = acquire(nd.first);
+                    if (page) hit_page(*page, r, inv_dir, t_min, best);
+                    continue;
+                }
+                // Filho mais próximo visitado primeiro: páginas atrás do primeiro acerto nem são mapeadas
+                double t_left = 0, t_right = 0;
+                bool left = enter(top[nd.first].box, r, inv_dir, t_min, best.t, t_left);
+                bool right = enter(top[nd.first + 1].box, r, inv_dir, t_min, best.t, t_right);
+                pending near{nd.first, t_left}, far{nd.first + 1, t_right};
+                if (left && right) {
+                    if (t_right < t_left) std::swap(near, far);
+                    stack[sp++] = far;
+                    stack[sp++] = near;
+                } else if (left) {
+                    stack[sp++] = near;
+                } else if (right) {
+                    stack[sp++] = far;
+                }
+            }
+
+            if (!best.found) return false;
+            rec.t = best.t;
+            rec.p = r.at(best.t);
+            rec.set_face_normal(r, best.normal);
+            rec.mat_ptr = materials[best.material];
+            rec.u = best.u;
+            rec.v = best.v;
+            return true;
+        }
+
+        virtual bool bounding_box(aabb& output_box) const override {
+            if (top.empty()) return false;
+            output_box = top[0].box;
+            return true;
+        }
+
+    private:
+        // BVH das páginas na memória (folha = uma página)
+        struct top_node {
+            aabb box;
+            uint32_t first = 0;
+            uint32_t count = 0;
+        };
+
+        struct nearest {
+            bool found = false;
+            double t = 0, u = 0, v = 0;
+            vec3 normal;
+            uint32_t material = 0;
+        };
+
+        shared_ptr<mesh_page_cache> cache;
+        uint32_t id;
+        std::vector<paged_mesh_page_entry> pages;
+        std::vector<top_node> top;
+        uint32_t material_count = 0;
+        uint64_t face_count = 0;
+#ifndef _WIN32
+        int fd = -1;
+#else
+        FILE* file = nullptr;
+        mutable std::mutex file_mutex;
+#endif
+
+        void close() {
+            pages.clear();
+            top.clear();
+#ifndef _WIN32
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+#else
+            if (file) std::fclose(file);
+            file = nullptr;
+#endif
+        }
+
+        static aabb entry_box(const paged_mesh_page_entry& e) {
+            return aabb(point3(e.minimum[0], e.minimum[1], e.minimum[2]),
+                        point3(e.maximum[0], e.maximum[1], e.maximum[2]));
+        }
+
+        void build_top() {
+            std::vector<uint32_t> order(pages.size());
+            std::vector<point3> centroids(pages.size());
+            for (uint32_t p = 0; p < pages.size(); p++) {
+                order[p] = p;
+                centroids[p] = entry_box(pages[p]).centroid();
+            }
+            top.reserve(2 * pages.size());
+            top.push_back(top_node());
+            build_top_node(0, order, centroids, 0, static_cast<uint32_t>(pages.size()));
+        }
+
+        void build_top_node(uint32_t n, std::vector<uint32_t>& order, const std::vector<point3>& centroids,
+                            uint32_t first, uint32_t count) {
+            aabb box;
+            for (uint32_t k = first; k < first + count; k++) box = surrounding_box(box, entry_box(pages[order[k]]));
+            top[n].box = box;
+
+            if (count == 1) {
+                top[n].first = order[first];
+                top[n].count = 1;
+                return;
+            }
+
+            uint32_t mid = split_by_centroid(order, centroids, first, count);
+            uint32_t left = static_cast<uint32_t>(top.size());
+            top.push_back(top_node());
+            top.push_back(top_node());
+            top[n].first = left;
+            top[n].count = 0;
+            build_top_node(left, order, centroids, first, mid - first);
+            build_top_node(left + 1, order, centroids, mid, first + count - mid);
+        }
+
+        // Teste de slabs que também devolve a distância de entrada
+        static bool enter(const aabb& box, const ray& r, const vec3& inv_dir, double t_min, double t_max, double& t_enter) {
+            for (int a = 0; a < 3; a++) {
+                double t0 = (box.minimum[a] - r.orig[a]) * inv_dir[a];
+                double t1 = (box.maximum[a] - r.orig[a]) * inv_dir[a];
+                if (inv_dir[a] < 0.0) std::swap(t0, t1);
+                t_min = t0 > t_min ? t0 : t_min;
+                t_max = t1 < t_max ? t1 : t_max;
+                if (t_max < t_min) return false;
+            }
+            t_enter = t_min;
+            return true;
+        }
+
+        static bool node_hit(const paged_mesh_node& nd, const ray& r, const vec3& inv_dir, double t_min, double t_max) {
+            for (int a = 0; a < 3; a++) {
+                double t0 = (nd.minimum[a] - r.orig[a]) * inv_dir[a];
+                double t1 = (nd.maximum[a] - r.orig[a]) * inv_dir[a];
+                if (inv_dir[a] < 0.0) std::swap(t0, t1);
+                t_min = t0 > t_min ? t0 : t_min;
+                t_max = t1 < t_max ? t1 : t_max;
+                if (t_max < t_min) return false;
+            }
+            return true;
+        }
+
+        shared_ptr<const mesh_page> acquire(uint32_t p) const {
+            uint64_t key = (static_cast<uint64_t>(id) << 32) | p;
+            return cache->fetch(key, [&]() { return load_page(pages[p]); });
+        }
+
+        shared_ptr<const mesh_page> load_page(const paged_mesh_page_entry& e) const {
+            auto page = make_shared<mesh_page>();
+#ifndef _WIN32
+            // O offset do mmap precisa ser múltiplo da página do sistema (o arquivo alinha a 4096)
+            uint64_t granularity = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            uint64_t start = e.offset - e.offset % granularity;
+            size_t length = static_cast<size_t>(e.offset - start) + e.bytes;
+            void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(start));
+            if (base == MAP_FAILED) return nullptr;
+            madvise(base, length, MADV_WILLNEED); // A página inteira numa leitura só
+            page->mapping = base;
+            page->mapping_length = length;
+            const char* data = static_cast<const char*>(base) + (e.offset - start);
+#else
+            void* base = std::malloc(e.bytes);
+            if (!base) return nullptr;
+            page->mapping = base;
+            {
+                std::lock_guard<std::mutex> lock(file_mutex);
+                if (_fseeki64(file, static_cast<long long>(e.offset), SEEK_SET) != 0
+                    || std::fread(base, 1, e.bytes, file) != e.bytes) return nullptr;
+            }
+            const char* data = static_cast<const char*>(base);
+#endif
+            page->bytes = e.bytes;
+            page->nodes = reinterpret_cast<const paged_mesh_node*>(data);
+            page->vertices = reinterpret_cast<const float*>(data + e.node_count * sizeof(paged_mesh_node));
+            page->faces = reinterpret_cast<const mesh_face*>(data + e.node_count * sizeof(paged_mesh_node)
+                                                             + e.vertex_count * 3 * sizeof(float));
+            return page;
+        }
+
+        void hit_page(const mesh_page& page, const ray& r, const vec3& inv_dir, double t_min, nearest& best) const {
+            uint32_t stack[64];
+            int sp = 0;
+            stack[sp++] = 0;
+            while (sp > 0) {
+                const paged_mesh_node& nd = page.nodes[stack[--sp]];
+                if (!node_hit(nd, r, inv_dir, t_min, best.t)) continue;
+
+                if (nd.count > 0) {
+                    for (uint32_t f = nd.first; f < nd.first + nd.count; f++)
+                        intersect(page, page.faces[f], r, t_min, best);
+                } else {
+                    stack[sp++] = nd.first + 1;
+                    stack[sp++] = nd.first;
+                }
+            }
+        }
+
+        // Möller–Trumbore sobre os vértices em float da página
+        static void intersect(const mesh_page& page, const mesh_face& f, const ray& r, double t_min, nearest& best) {
+            const float* a = page.vertices + 3 * f.v[0];
+            const float* b = page.vertices + 3 * f.v[1];
+            const float* c = page.vertices + 3 * f.v[2];
+            point3 v0(a[0], a[1], a[2]);
+            vec3 v0v1 = point3(b[0], b[1], b[2]) - v0;
+            vec3 v0v2 = point3(c[0], c[1], c[2]) - v0;
+            vec3 pvec = cross(r.direction(), v0v2);
+            double det = dot(v0v1, pvec);
+
+            if (fabs(det) < 1e-8) return;
+            double invDet = 1.0 / det;
+
+            vec3 tvec = r.origin() - v0;
+            double u = dot(tvec, pvec) * invDet;
+            if (u < 0 || u > 1) return;
+
+            vec3 qvec = cross(tvec, v0v1);
+            double v = dot(r.direction(), qvec) * invDet;
+            if (v < 0 || u + v > 1) return;
+
+            double t = dot(v0v2, qvec) * invDet;
+            if (t < t_min || t > best.t) return;
+
+            // A página pode ser despejada depois: a normal é calculada enquanto ela está presa
+            best.found = true;
+            best.t = t;
+            best.u = u;
+            best.v = v;
+            best.normal = unit_vector(cross(v0v1, v0v2));
+            best.material = f.material;
+        }
+};
+
+#endif
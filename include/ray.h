@@ -8,6 +8,11 @@ class ray {
         point3 orig;
         vec3 dir;
 
+        // Cone do raio (para filtrar texturas): largura na origem e quanto ela cresce por unidade
+        // de distância. Raios de câmera abrem com o ângulo de um pixel; zero = raio sem cone.
+        double width = 0.0;
+        double spread = 0.0;
+
         ray() {}
         ray(const point3& origin, const vec3& direction)
             : orig(origin), dir(direction) {}
@@ -19,6 +24,11 @@ class ray {
         point3 at(double t) const {
             return orig + t*dir;
         }
+
+        // Largura do cone no parâmetro t
+        double width_at(double t) const {
+            return width + spread * t * dir.length();
+        }
 };
 
 #endif
\ No newline at end of file
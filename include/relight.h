@@ -0,0 +1,266 @@
+#ifndef RELIGHT_H
+#define RELIGHT_H
+
+#include "utils.h"
+#include "scene.h"
+#include "renderer.h"
+#include "framebuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// --- Cache de Relighting ---
+//
+// Se só luzes (posição/intensidade) ou coeficientes de material (ka, ks, shininess) mudam,
+// a visibilidade primária é a mesma. Guardamos, por AMOSTRA, o que o raio primário achou
+// (ponto, normal, UV, material) e um bit de visibilidade por luz. Uma edição de luz ou
+// material só refaz o sombreamento; raios de sombra são refeitos apenas para luzes que se moveram.
+//
+// Memória: ~52 bytes por amostra (floats), ou seja ~260 MB para 500x500 a 20 spp.
+// Só a iluminação direta é cacheada: amostras em materiais com kr/kt > 0 retraçam os raios de
+// reflexão e refração a partir do hit guardado a cada sombreamento (ver secondary_color).
+
+// Um registro por amostra primária
+struct primary_sample {
+    float p[3];            // Ponto atingido (mundo)
+    float n[3];            // Normal de sombreamento (unitária)
+    float d[3];            // Direção do raio primário (para o fundo e o vetor de visada)
+    float u, v;            // Coordenadas de textura
+    uint32_t material_id : 31;  // Índice em relight_cache::materials (no_material = fundo)
+    uint32_t front_face : 1;    // O raio bateu por fora (decide o eta da refração)
+    uint32_t shadow_mask;       // Bit k ligado = luz k visível deste ponto
+};
+
+class relight_cache {
+    public:
+        static const uint32_t no_material = 0x7fffffffu;
+        static const int max_lights = 32; // Um bit por luz em shadow_mask
+
+        int width = 0;
+        int height = 0;
+        int spp = 0;
+        std::vector<primary_sample> samples;     // Pixel (i,j), amostra s em ((j*width + i)*spp + s)
+        std::vector<const material*> materials;  // Tabela de materiais (material_id -> material)
+        std::vector<PointLight> shadow_lights;   // Luzes com que os bits de sombra foram calculados
+
+        // Contadores da última operação
+        long primary_rays = 0;
+        long shadow_rays = 0;
+        long shadow_cache_hits = 0; // Sombras resolvidas pelo cache de oclusores (ver renderer.h)
+        long secondary_rays = 0;    // Raios de reflexão/refração do último sombreamento
+        int lights_retraced = 0;
+
+        bool valid() const { return !samples.empty(); }
+
+        // Traça todos os raios primários (e as sombras de todas as luzes) e guarda os registros
+        void build(const camera& cam, const scene& sc, int w, int h, int samples_per_pixel,
+                   const render_settings& settings) {
+            width = w;
+            height = h;
+            spp = samples_per_pixel;
+            samples.assign(static_cast<size_t>(w) * h * spp, primary_sample());
+            materials.clear();
+            material_ids.clear();
+            shadow_lights.clear();
+
+            const hittable& world = sc.root();
+            // Materiais ficam num vetor temporário durante o traço (sem trava entre threads);
+            // os IDs compactos são atribuídos depois, em série.
+            std::vector<const material*> hit_materials(samples.size(), nullptr);
+
+            pixel_region all{0, 0, w, h};
+            parallel_tiles(all, settings.tile_size, settings.threads, [&](const pixel_region& tile) {
+                for (int j = tile.y0; j < tile.y1; ++j) {
+                    for (int i = tile.x0; i < tile.x1; ++i) {
+                        for (int s = 0; s < spp; ++s) {
+                            auto u = (i + random_double()) / (w-1);
+                            auto v = (j + random_double()) / (h-1);
+                            ray r = cam.get_ray(u, v);
+
+                            primary_sample& ps = at(i, j, s);
+                            store(ps.d, r.direction());
+                            ps.material_id = no_material;
+                            ps.shadow_mask = 0;
+
+                            hit_record rec;
+                            if (!world.hit(r, 0.001, infinity, rec)) continue;
+
+                            store(ps.p, rec.p);
+                            store(ps.n, unit_vector(rec.normal));
+                            ps.u = static_cast<float>(rec.u);
+                            ps.v = static_cast<float>(rec.v);
+                            ps.front_face = rec.front_face;
+                            hit_materials[&ps - samples.data()] = rec.mat_ptr;
+                        }
+                    }
+                }
+            }, "relight.trace");
+            for (size_t k = 0; k < samples.size(); k++)
+                if (hit_materials[k]) samples[k].material_id = material_id(hit_materials[k]);
+            primary_rays = static_cast<long>(samples.size());
+
+            lights_retraced = 0;
+            shadow_rays = 0;
+            update_lights(sc, settings);
+        }
+
+        // Refaz os bits de sombra só das luzes que mudaram de posição (ou que são novas).
+        // Retorna quantas luzes foram retraçadas.
+        int update_lights(const scene& sc, const render_settings& settings) {
+            int count = std::min(static_cast<int>(sc.lights.size()), max_lights);
+            uint32_t moved = 0;
+            for (int k = 0; k < count; k++) {
+                bool same = k < static_cast<int>(shadow_lights.size())
+                         && (shadow_lights[k].position - sc.lights[k].position).length_squared() == 0.0;
+                if (!same) moved |= 1u << k;
+            }
+            shadow_lights.assign(sc.lights.begin(), sc.lights.begin() + count);
+
+            lights_retraced = 0;
+            shadow_rays = 0;
+            shadow_cache_hits = 0;
+            if (moved == 0) return 0;
+            for (int k = 0; k < count; k++) if (moved & (1u << k)) lights_retraced++;
+
+            const hittable& world = sc.root();
+            std::atomic<long> traced{0};
+            std::atomic<long> cache_hits{0};
+            pixel_region all{0, 0, width, height};
+            parallel_tiles(all, settings.tile_size, settings.threads, [&](const pixel_region& tile) {
+                long local = 0;
+                ray_stats tile_stats;
+                shadow_cache tile_shadows;
+                shadow_cache* cache = settings.trace.shadow_cache ? &tile_shadows : nullptr;
+                for (int j = tile.y0; j < tile.y1; ++j) {
+                    for (int i = tile.x0; i < tile.x1; ++i) {
+                        for (int s = 0; s < spp; ++s) {
+                            primary_sample& ps = at(i, j, s);
+                            if (ps.material_id == no_material) continue;
+
+                            point3 p = load(ps.p);
+                            vec3 n = load(ps.n);
+                            for (int k = 0; k < count; k++) {
+                                uint32_t bit = 1u << k;
+                                if (!(moved & bit)) continue;
+
+                                double light_dist;
+                                ray shadow_ray = shadow_ray_to(p, n, shadow_lights[k], light_dist);
+                                if (shadow_blocked(world, shadow_ray, light_dist, k, cache, tile_stats))
+                                    ps.shadow_mask &= ~bit;
+                                else
+                                    ps.shadow_mask |= bit;
+                                local++;
+                            }
+                        }
+                    }
+                }
+                traced += local;
+                cache_hits += tile_stats.shadow_cache_hits;
+            }, "relight.retrace");
+            shadow_rays = traced;
+            shadow_cache_hits = cache_hits;
+            return lights_retraced;
+        }
+
+        // Passo de sombreamento: recalcula Blinn-Phong de todas as amostras e reescreve o framebuffer.
+        // Usa os materiais e intensidades ATUAIS da cena, com a visibilidade guardada; reflexão e
+        // refração são retraçadas. Se 'stats' não for nulo, soma nele os raios secundários.
+        void shade(const scene& sc, framebuffer& fb, const render_settings& settings, ray_stats* stats = nullptr) {
+            if (fb.width != width || fb.height != height) fb.resize(width, height);
+            int count = static_cast<int>(shadow_lights.size());
+            const hittable& world = sc.root();
+            std::atomic<long> traced{0};
+            std::mutex stats_mutex;
+
+            pixel_region all{0, 0, width, height};
+            parallel_tiles(all, settings.tile_size, settings.threads, [&](const pixel_region& tile) {
+                ray_stats tile_stats;
+                shadow_cache tile_shadows;
+                for (int j = tile.y0; j < tile.y1; ++j) {
+                    for (int i = tile.x0; i < tile.x1; ++i) {
+                        color sum(0, 0, 0);
+                        for (int s = 0; s < spp; ++s) {
+                            const primary_sample& ps = at(i, j, s);
+                            vec3 dir = load(ps.d);
+                            if (ps.material_id == no_material) {
+                                sum += background_color(dir);
+                                continue;
+                            }
+
+                            const material& mat = *materials[ps.material_id];
+                            point3 p = load(ps.p);
+                            vec3 normal = load(ps.n);
+                            color color_diffuse = mat.kd->value(ps.u, ps.v, p) * mat.diffuse_weight();
+                            color result = mat.ka * color_diffuse;
+                            vec3 view_dir = unit_vector(-dir);
+
+                            for (int k = 0; k < count; k++) {
+                                if (!(ps.shadow_mask & (1u << k))) continue;
+                                // Posição atual: só a intensidade pode ter mudado desde o traço da sombra
+                                vec3 light_dir = unit_vector(sc.lights[k].position - p);
+                                result += blinn_phong_term(mat, color_diffuse, normal, view_dir,
+                                                           light_dir, sc.lights[k].intensity);
+                            }
+
+                            if (mat.is_reflective() || mat.is_transparent()) {
+                                // Hit reconstruído com o raio partindo do próprio ponto (t = 0): os
+                                // raios primários do cache não têm cone, então a largura é a mesma
+                                hit_record rec;
+                                rec.p = p;
+                                rec.normal = normal;
+                                rec.mat_ptr = const_cast<material*>(&mat);
+                                rec.t = 0;
+                                rec.u = ps.u;
+                                rec.v = ps.v;
+                                rec.front_face = ps.front_face;
+                                result += secondary_color(ray(p, dir), rec, normal, world, sc.lights,
+                                                          settings.trace, tile_stats, tile_shadows, 0, color(1,1,1));
+                            }
+                            sum += result;
+                        }
+                        size_t idx = fb.index(i, j);
+                        fb.accum[idx] = sum;
+                        fb.samples[idx] = spp;
+                    }
+                }
+                long local = 0;
+                for (int d = 1; d < ray_stats::max_tracked; d++) local += tile_stats.rays[d];
+                traced += local;
+                if (stats) {
+                    std::lock_guard<std::mutex> lock(stats_mutex);
+                    stats->add(tile_stats);
+                }
+            }, "shade");
+            secondary_rays = traced;
+        }
+
+        size_t memory_bytes() const { return samples.size() * sizeof(primary_sample); }
+
+    private:
+        std::unordered_map<const material*, uint32_t> material_ids;
+
+        primary_sample& at(int i, int j, int s) { return samples[(static_cast<size_t>(j) * width + i) * spp + s]; }
+        const primary_sample& at(int i, int j, int s) const { return samples[(static_cast<size_t>(j) * width + i) * spp + s]; }
+
+        uint32_t material_id(const material* mat) {
+            auto it = material_ids.find(mat);
+            if (it != material_ids.end()) return it->second;
+            uint32_t id = static_cast<uint32_t>(materials.size());
+            materials.push_back(mat);
+            material_ids[mat] = id;
+            return id;
+        }
+
+        static void store(float* out, const vec3& v) {
+            out[0] = static_cast<float>(v.x());
+            out[1] = static_cast<float>(v.y());
+            out[2] = static_cast<float>(v.z());
+        }
+
+        static vec3 load(const float* in) { return vec3(in[0], in[1], in[2]); }
+};
+
+#endif
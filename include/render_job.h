@@ -0,0 +1,266 @@
+#ifndef RENDER_JOB_H
+#define RENDER_JOB_H
+
+#include "utils.h"
+#include "scene.h"
+#include "camera.h"
+#include "framebuffer.h"
+#include "renderer.h"
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --- Jobs de Render Assíncronos ---
+//
+// render_frame/parallel_tiles criam threads novas a cada chamada e travam quem chamou até o fim:
+// ótimo para uma imagem grande, ruim para um serviço que gera muitas miniaturas ao mesmo tempo
+// (a criação das threads e a espera pelo último tile dominam). render_pool tem threads fixas e
+// uma fila de jobs; submit() devolve na hora um render_job com um std::future do resultado.
+//   - as threads pegam tiles dos jobs ativos em rodízio: jobs pequenos não esperam um grande terminar
+//     e nenhuma thread fica parada enquanto algum job tiver tile livre;
+//   - cancel() para de distribuir tiles do job; os que já estão sendo traçados terminam e o future
+//     recebe a imagem parcial com 'cancelled' = true;
+//   - on_tile e on_progress são chamados nas threads do pool, possivelmente em paralelo entre si.
+// A cena é só lida pelo job (as luzes são copiadas no submit) e precisa viver até o job terminar.
+// Editar a cena (materiais, BVH) com jobs rodando não é seguro, como na sessão.
+
+struct render_job_callbacks {
+    // Tile pronto: a região do framebuffer do job já tem as amostras finais do tile
+    std::function<void(const pixel_region& tile, const framebuffer& fb)> on_tile;
+    // Tiles prontos / total, depois de cada tile
+    std::function<void(int done, int total)> on_progress;
+};
+
+struct render_result {
+    framebuffer image;
+    bool cancelled = false;
+    long samples = 0;
+    int tiles_done = 0;
+    int tiles_total = 0;
+    ray_stats stats;
+    double elapsed_ms = 0.0; // Do submit até o último tile
+};
+
+namespace detail {
+
+struct render_job_state {
+    const scene* sc = nullptr;
+    camera cam;
+    std::vector<PointLight> lights;
+    render_settings settings;
+    render_job_callbacks callbacks;
+    std::chrono::steady_clock::time_point submitted;
+
+    std::vector<pixel_region> tiles;
+    std::atomic<bool> cancel_requested{false};
+    std::atomic<int> tiles_done{0};
+    std::atomic<long> samples{0};
+
+    // Protegidos pela trava do pool
+    size_t next_tile = 0;
+    int in_flight = 0;
+    bool closed = false;    // Não distribui mais tiles (acabaram ou cancelado)
+    bool finished = false;
+
+    std::mutex stats_mutex;
+    render_result result;   // image/stats preenchidos pelos tiles
+    std::promise<render_result> promise;
+
+    explicit render_job_state(const camera& c) : cam(c) {}
+};
+
+}
+
+// Handle de um job: o resultado sai do future (uma vez, como std::future::get)
+class render_job {
+    public:
+        render_job() {}
+
+        bool valid() const { return future.valid(); }
+
+        void cancel() {
+            if (state) state->cancel_requested = true;
+        }
+
+        // Fração dos tiles prontos
+        double progress() const {
+            if (!state || state->tiles.empty()) return 1.0;
+            return double(state->tiles_done) / state->tiles.size();
+        }
+
+        void wait() const { future.wait(); }
+
+        template <typename Rep, typename Period>
+        bool wait_for(const std::chrono::duration<Rep, Period>& timeout) const {
+            return future.wait_for(timeout) == std::future_status::ready;
+        }
+
+        render_result get() { return future.get(); }
+
+    private:
+        friend class render_pool;
+        std::shared_ptr<detail::render_job_state> state;
+        std::future<render_result> future;
+};
+
+class render_pool {
+    public:
+        // 0 = número de núcleos da máquina
+        explicit render_pool(int threads = 0) {
+            int n = resolve_thread_count(threads);
+            for (int k = 0; k < n; k++) workers.emplace_back([this]() { work(); });
+        }
+
+        // Cancela os jobs ainda na fila e espera os tiles em andamento
+        ~render_pool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                for (auto& job : active) job->cancel_requested = true;
+            }
+            wake.notify_all();
+            for (auto& th : workers) th.join();
+        }
+
+        render_pool(const render_pool&) = delete;
+        render_pool& operator=(const render_pool&) = delete;
+
+        int thread_count() const { return static_cast<int>(workers.size()); }
+
+        // Renderiza a cena vista por 'cam' numa imagem width x height até settings.samples_per_pixel.
+        // settings.threads é ignorado (vale o pool); tile_size, trace e culling valem por job.
+        render_job submit(const scene& sc, const camera& cam, int width, int height,
+                          const render_settings& settings, render_job_callbacks callbacks = render_job_callbacks()) {
+            auto job = std::make_shared<detail::render_job_state>(cam);
+            job->sc = &sc;
+            job->lights = sc.lights;
+            job->settings = settings;
+            job->callbacks = std::move(callbacks);
+            job->submitted = std::chrono::steady_clock::now();
+            job->result.image.resize(width, height);
+
+            // Mesma ordem de parallel_tiles: do topo da imagem para baixo
+            int tile_size = std::max(1, settings.tile_size);
+            int tiles_x = (width + tile_size - 1) / tile_size;
+            int tiles_y = (height + tile_size - 1) / tile_size;
+            for (int ty = tiles_y - 1; ty >= 0; ty--) {
+                for (int tx = 0; tx < tiles_x; tx++) {
+                    pixel_region tile;
+                    tile.x0 = tx * tile_size;
+                    tile.y0 = ty * tile_size;
+                    tile.x1 = std::min(tile.x0 + tile_size, width);
+                    tile.y1 = std::min(tile.y0 + tile_size, height);
+                    job->tiles.push_back(tile);
+                }
+            }
+            job->result.tiles_total = static_cast<int>(job->tiles.size());
+
+            render_job handle;
+            handle.state = job;
+            handle.future = job->promise.get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (job->tiles.empty() || stopping) {
+                    job->closed = true;
+                    job->cancel_requested = stopping;
+                    finish(*job);
+                    return handle;
+                }
+                active.push_back(job);
+            }
+            wake.notify_all();
+            return handle;
+        }
+
+    private:
+        using job_ptr = std::shared_ptr<detail::render_job_state>;
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<job_ptr> active;  // Jobs com tiles para distribuir (rodízio: o da frente dá um tile e vai para o fim)
+        bool stopping = false;
+
+        void work() {
+            static std::atomic<int> next_worker{0};
+            int id = next_worker++;
+            std::string name = "pool " + std::to_string(id);
+            trace_recorder::global().name_thread(name.c_str());
+
+            while (true) {
+                job_ptr job;
+                pixel_region tile;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    while (!take_tile(job, tile)) {
+                        if (stopping && active.empty()) return;
+                        wake.wait(lock);
+                    }
+                }
+                run_tile(*job, tile);
+            }
+        }
+
+        // Com a trava: próximo tile do rodízio; jobs cancelados ou sem tiles saem da fila
+        bool take_tile(job_ptr& job, pixel_region& tile) {
+            while (!active.empty()) {
+                job_ptr front = active.front();
+                active.pop_front();
+                if (front->cancel_requested || front->next_tile >= front->tiles.size()) {
+                    front->closed = true;
+                    if (front->in_flight == 0) finish(*front);
+                    continue;
+                }
+                tile = front->tiles[front->next_tile++];
+                front->in_flight++;
+                if (front->next_tile < front->tiles.size()) active.push_back(front);
+                else front->closed = true;
+                job = front;
+                return true;
+            }
+            return false;
+        }
+
+        void run_tile(detail::render_job_state& job, const pixel_region& tile) {
+            {
+                trace_scope scope("job.tile", "tile", tile.x0, tile.y0);
+                ray_stats tile_stats;
+                shadow_cache tile_shadows;
+                job.samples += render_tile(job.cam, job.sc->root(), job.lights, job.result.image, tile,
+                                           job.settings.samples_per_pixel, job.settings, tile_stats, tile_shadows);
+                std::lock_guard<std::mutex> lock(job.stats_mutex);
+                job.result.stats.add(tile_stats);
+            }
+            int done = ++job.tiles_done;
+            if (job.callbacks.on_tile) job.callbacks.on_tile(tile, job.result.image);
+            if (job.callbacks.on_progress) job.callbacks.on_progress(done, static_cast<int>(job.tiles.size()));
+
+            std::lock_guard<std::mutex> lock(mutex);
+            job.in_flight--;
+            if (job.closed && job.in_flight == 0) finish(job);
+        }
+
+        // Com a trava: entrega o resultado (uma vez por job)
+        static void finish(detail::render_job_state& job) {
+            if (job.finished) return;
+            job.finished = true;
+            job.result.cancelled = job.tiles_done < job.result.tiles_total;
+            job.result.tiles_done = job.tiles_done;
+            job.result.samples = job.samples;
+            job.result.elapsed_ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - job.submitted).count();
+            job.promise.set_value(std::move(job.result));
+        }
+};
+
+#endif
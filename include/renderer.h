@@ -0,0 +1,514 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "utils.h"
+#include "hittable.h"
+#include "material.h"
+#include "camera.h"
+#include "scene.h"
+#include "framebuffer.h"
+#include "frustum.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --- Ray Tracing (Blinn-Phong + Whitted) ---
+
+// Contribuição difusa + especular de uma luz visível
+inline color blinn_phong_term(const material& mat, const color& color_diffuse, const vec3& normal,
+                              const vec3& view_dir, const vec3& light_dir, const color& intensity) {
+    double diff = fmax(dot(normal, light_dir), 0.0);
+    color diffuse = diff * color_diffuse;
+
+    vec3 halfway_dir = unit_vector(light_dir + view_dir);
+    double spec = pow(fmax(dot(normal, halfway_dir), 0.0), mat.shininess);
+    color specular = spec * mat.ks;
+
+    return (diffuse + specular) * intensity;
+}
+
+// Fundo (gradiente do céu)
+inline color background_color(const vec3& direction) {
+    vec3 unit_direction = unit_vector(direction);
+    auto t = 0.5*(unit_direction.y() + 1.0);
+    return (1.0-t)*color(1.0, 1.0, 1.0) + t*color(0.5, 0.7, 1.0);
+}
+
+// Origem do raio de sombra: afastada da superfície para não bater nela mesma
+inline ray shadow_ray_to(const point3& p, const vec3& normal, const PointLight& light, double& light_dist) {
+    light_dist = (light.position - p).length();
+    return ray(p + 0.001*normal, unit_vector(light.position - p));
+}
+
+// Limites dos raios secundários (reflexão e refração)
+struct trace_settings {
+    int max_depth = 6;            // Profundidade máxima (0 = raio primário)
+    double min_throughput = 0.02; // Abaixo disso a contribuição é desprezada (corte seco)
+    int roulette_depth = 2;       // A partir desta profundidade entra a roleta russa
+    bool shadow_cache = true;     // Testa primeiro o último oclusor de cada luz (ver shadow_cache)
+};
+
+// Contadores de raios por profundidade (cada thread usa os seus e soma no fim do tile)
+struct ray_stats {
+    static const int max_tracked = 16;  // Profundidades maiores caem no último contador
+    long rays[max_tracked] = {};        // Raios de câmera/secundários por profundidade
+    long shadow_rays[max_tracked] = {}; // Raios de sombra disparados em cada profundidade
+    long cut_depth = 0;       // Caminhos encerrados por max_depth
+    long cut_throughput = 0;  // ... por contribuição abaixo de min_throughput
+    long cut_roulette = 0;    // ... pela roleta russa
+    long shadow_cache_tries = 0; // Raios de sombra em que havia um oclusor no cache
+    long shadow_cache_hits = 0;  // ... e ele de fato bloqueou (travessia completa evitada)
+    long culled_tiles = 0;       // Tiles cujos raios primários usaram a lista de candidatos
+    long tile_candidates = 0;    // Soma dos candidatos desses tiles
+
+    void count_ray(int depth) { rays[std::min(depth, max_tracked - 1)]++; }
+    void count_shadow(int depth) { shadow_rays[std::min(depth, max_tracked - 1)]++; }
+
+    void add(const ray_stats& o) {
+        for (int d = 0; d < max_tracked; d++) {
+            rays[d] += o.rays[d];
+            shadow_rays[d] += o.shadow_rays[d];
+        }
+        cut_depth += o.cut_depth;
+        cut_throughput += o.cut_throughput;
+        cut_roulette += o.cut_roulette;
+        shadow_cache_tries += o.shadow_cache_tries;
+        shadow_cache_hits += o.shadow_cache_hits;
+        culled_tiles += o.culled_tiles;
+        tile_candidates += o.tile_candidates;
+    }
+
+    long total() const {
+        long n = 0;
+        for (int d = 0; d < max_tracked; d++) n += rays[d] + shadow_rays[d];
+        return n;
+    }
+
+    // "d0 N/M d1 N/M ..." (raios/sombras por profundidade, até a última usada)
+    void print(std::ostream& out) const {
+        int last = 0;
+        for (int d = 0; d < max_tracked; d++) if (rays[d] > 0) last = d;
+        for (int d = 0; d <= last; d++)
+            out << (d ? " " : "") << 'd' << d << ' ' << rays[d] << '/' << shadow_rays[d];
+        out << " cortes profundidade " << cut_depth << " contribuicao " << cut_throughput
+            << " roleta " << cut_roulette;
+        long shadows = 0;
+        for (int d = 0; d < max_tracked; d++) shadows += shadow_rays[d];
+        out << " cache_sombra " << shadow_cache_hits << '/' << shadow_cache_tries << " acertos ("
+            << (shadows > 0 ? 100.0 * shadow_cache_hits / shadows : 0.0) << "% das sombras)";
+        if (culled_tiles > 0)
+            out << " culling " << culled_tiles << " tiles (" << double(tile_candidates) / culled_tiles << " candidatos/tile)";
+    }
+};
+
+// Cache de oclusores: pontos vizinhos costumam ter a luz bloqueada pelo mesmo objeto (o chão à
+// sombra do altar). Guarda, por luz, o último objeto de primeiro nível que bloqueou e o testa
+// antes da travessia completa. Um por tile (ou thread): sem compartilhamento, sem trava.
+struct shadow_cache {
+    std::vector<const hittable*> last; // Índice = luz
+
+    const hittable*& slot(size_t light) {
+        if (light >= last.size()) last.resize(light + 1, nullptr);
+        return last[light];
+    }
+};
+
+// Raio de sombra com cache: qualquer oclusor antes da luz serve, não precisa ser o mais próximo.
+// O cache passa a guardar o oclusor achado pela travessia, ou nada se a luz estiver visível
+// (assim regiões iluminadas não pagam o teste extra).
+inline bool shadow_blocked(const hittable& world, const ray& shadow_ray, double light_dist, size_t light,
+                           shadow_cache* cache, ray_stats& stats) {
+    hit_record rec;
+    if (!cache) return world.hit(shadow_ray, 0.001, light_dist, rec);
+
+    const hittable*& last = cache->slot(light);
+    if (last) {
+        stats.shadow_cache_tries++;
+        if (last->hit(shadow_ray, 0.001, light_dist, rec)) {
+            stats.shadow_cache_hits++;
+            return true;
+        }
+    }
+    bool blocked = world.hit(shadow_ray, 0.001, light_dist, rec);
+    last = blocked ? rec.object : nullptr;
+    return blocked;
+}
+
+// Aproximação de Schlick para a refletância de Fresnel
+inline double schlick_reflectance(double cosine, double eta) {
+    double r0 = (1 - eta) / (1 + eta);
+    r0 = r0*r0;
+    return r0 + (1 - r0)*pow(1 - cosine, 5);
+}
+
+inline double max_component(const color& c) {
+    return fmax(c.x(), fmax(c.y(), c.z()));
+}
+
+// AOVs de uma amostra primária (guias do denoiser, ver denoise.h)
+struct aov_sample {
+    color albedo;
+    vec3 normal;
+    double depth = 0.0;
+    double luminance2 = 0.0; // Quadrado da luminância da cor final da amostra
+
+    aov_sample& operator+=(const aov_sample& o) {
+        albedo += o.albedo;
+        normal += o.normal;
+        depth += o.depth;
+        luminance2 += o.luminance2;
+        return *this;
+    }
+};
+
+inline double luminance(const color& c) {
+    return 0.2126*c.x() + 0.7152*c.y() + 0.0722*c.z();
+}
+
+// Profundidade dada ao fundo (longe de qualquer objeto, para o denoiser não misturar)
+const double background_depth = 1e4;
+
+// Pegada do cone do raio no ponto atingido: dois raios paralelos deslocados pela largura do
+// cone (em direções perpendiculares) contra o mesmo objeto. A diferença de UV e de posição
+// já inclui o alongamento em ângulos rasantes. Vizinhos que caem em outra face não contam.
+inline texture_footprint ray_footprint(const ray& r, const hit_record& rec, const hittable& world) {
+    texture_footprint fp;
+    double width = r.width_at(rec.t);
+    if (width <= 0) return fp;
+
+    vec3 d = unit_vector(r.direction());
+    vec3 a = unit_vector(cross(d, fabs(d.x()) > 0.9 ? vec3(0, 1, 0) : vec3(1, 0, 0)));
+    vec3 b = cross(d, a);
+    const hittable& target = rec.object ? *rec.object : world;
+    for (const vec3& offset : {width * a, width * b}) {
+        hit_record near;
+        if (!target.hit(ray(r.origin() + offset, r.direction()), 0.001, infinity, near)) continue;
+        if (dot(near.normal, rec.normal) < 0.9 * near.normal.length() * rec.normal.length()) continue;
+        // UV dá a volta (u = 0 e u = 1 são a mesma costura da esfera)
+        double du = fabs(near.u - rec.u), dv = fabs(near.v - rec.v);
+        du = fmin(du, fabs(1.0 - du));
+        dv = fmin(dv, fabs(1.0 - dv));
+        fp.uv = fmax(fp.uv, sqrt(du*du + dv*dv));
+        fp.world = fmax(fp.world, (near.p - rec.p).length());
+    }
+    return fp;
+}
+
+// Cor da textura difusa no ponto atingido (filtrada pela pegada se a textura usar mip-maps)
+inline color surface_albedo(const ray& r, const hit_record& rec, const hittable& world) {
+    const texture& tex = *rec.mat_ptr->kd;
+    if (!tex.uses_footprint()) return tex.value(rec.u, rec.v, rec.p);
+    return tex.filtered_value(rec.u, rec.v, rec.p, ray_footprint(r, rec, world));
+}
+
+// AOVs de um raio que foi para o fundo
+inline aov_sample make_aov(const ray& r) {
+    return aov_sample{background_color(r.direction()), vec3(0,0,0), background_depth};
+}
+
+// AOVs do hit primário 'rec'
+inline aov_sample make_aov(const ray& r, const hit_record& rec, const color& albedo) {
+    return aov_sample{albedo, unit_vector(rec.normal), rec.t * r.direction().length()};
+}
+
+inline color ray_color(const ray& r, const hittable& world, const std::vector<PointLight>& lights,
+                       const trace_settings& trace, ray_stats& stats, shadow_cache& shadows,
+                       int depth = 0, const color& throughput = color(1,1,1), aov_sample* aov = nullptr);
+
+// Parcela de reflexão (kr) e refração (kt) do hit 'rec' do raio 'r', com 'normal' unitária contra o raio.
+// Separada de ray_color para o relighting (relight.h) reaproveitar a partir de um hit guardado.
+inline color secondary_color(const ray& r, const hit_record& rec, const vec3& normal, const hittable& world,
+                             const std::vector<PointLight>& lights, const trace_settings& trace,
+                             ray_stats& stats, shadow_cache& shadows, int depth, const color& throughput) {
+    const material& mat = *rec.mat_ptr;
+    if (!mat.is_reflective() && !mat.is_transparent()) return color(0, 0, 0);
+    if (depth + 1 >= trace.max_depth) {
+        stats.cut_depth++;
+        return color(0, 0, 0);
+    }
+
+    // D. Pesos de reflexão e refração (Fresnel divide kt entre as duas)
+    vec3 view_dir = unit_vector(-r.direction());
+    vec3 unit_dir = -view_dir;
+    color reflect_weight = mat.kr;
+    color refract_weight(0, 0, 0);
+    vec3 refract_dir;
+    if (mat.is_transparent()) {
+        double eta = rec.front_face ? 1.0 / mat.ior : mat.ior;
+        double cos_theta = fmin(dot(view_dir, normal), 1.0);
+        double sin_theta = sqrt(1.0 - cos_theta*cos_theta);
+        if (eta * sin_theta > 1.0) {
+            reflect_weight += mat.kt; // Reflexão interna total
+        } else {
+            double fresnel = schlick_reflectance(cos_theta, eta);
+            reflect_weight += fresnel * mat.kt;
+            refract_weight = (1.0 - fresnel) * mat.kt;
+            refract_dir = refract(unit_dir, normal, eta);
+        }
+    }
+
+    // E. Raios secundários (continuam o cone do raio atual a partir da largura no ponto atingido)
+    double cone_width = r.width_at(rec.t);
+    auto secondary = [&](const color& weight, ray next) {
+        next.width = cone_width;
+        next.spread = r.spread;
+        color next_throughput = throughput * weight;
+        double importance = max_component(next_throughput);
+        if (importance < trace.min_throughput) {
+            stats.cut_throughput++;
+            return color(0, 0, 0);
+        }
+        double survive = 1.0;
+        if (depth + 1 >= trace.roulette_depth) {
+            survive = fmin(1.0, importance);
+            if (random_double() >= survive) {
+                stats.cut_roulette++;
+                return color(0, 0, 0);
+            }
+        }
+        return weight * ray_color(next, world, lights, trace, stats, shadows, depth + 1, next_throughput) / survive;
+    };
+
+    color result(0, 0, 0);
+    if (max_component(reflect_weight) > 0)
+        result += secondary(reflect_weight, ray(rec.p + 0.001*normal, reflect(unit_dir, normal)));
+    if (max_component(refract_weight) > 0)
+        result += secondary(refract_weight, ray(rec.p - 0.001*normal, refract_dir));
+    return result;
+}
+
+// Whitted: Blinn-Phong local + reflexão (kr) e refração (kt) recursivas.
+// 'throughput' é quanto este raio ainda pesa no pixel; o custo de espelhos profundos é contido
+// por max_depth, pelo corte em min_throughput e pela roleta russa: depois de roulette_depth, um
+// raio secundário sobrevive com probabilidade igual ao seu peso e, se sobreviver, a contribuição
+// é dividida por essa probabilidade (a média continua a mesma, sem viés).
+inline color ray_color(const ray& r, const hittable& world, const std::vector<PointLight>& lights,
+                       const trace_settings& trace, ray_stats& stats, shadow_cache& shadows,
+                       int depth, const color& throughput, aov_sample* aov) {
+    hit_record rec;
+    stats.count_ray(depth);
+
+    if (!world.hit(r, 0.001, infinity, rec)) {
+        if (aov) *aov = make_aov(r);
+        return background_color(r.direction());
+    }
+
+    // Dados do Material
+    const material& mat = *rec.mat_ptr;
+    color albedo = surface_albedo(r, rec, world);
+    if (aov) *aov = make_aov(r, rec, albedo);
+    color color_diffuse = albedo * mat.diffuse_weight();
+
+    // A. Ambiental
+    color result = mat.ka * color_diffuse;
+
+    // Vetores
+    vec3 view_dir = unit_vector(-r.direction());
+    vec3 normal = unit_vector(rec.normal);
+
+    for (size_t k = 0; k < lights.size(); k++) {
+        const PointLight& light = lights[k];
+        // B. Sombra (Shadow Ray)
+        double light_dist;
+        ray shadow_ray = shadow_ray_to(rec.p, normal, light, light_dist);
+        stats.count_shadow(depth);
+        if (shadow_blocked(world, shadow_ray, light_dist, k, trace.shadow_cache ? &shadows : nullptr, stats)) continue;
+
+        // C. Difusa e Especular
+        result += blinn_phong_term(mat, color_diffuse, normal, view_dir, shadow_ray.direction(), light.intensity);
+    }
+
+    return result + secondary_color(r, rec, normal, world, lights, trace, stats, shadows, depth, throughput);
+}
+
+// Retângulo de pixels [x0, x1) x [y0, y1), com y = 0 na linha de baixo
+struct pixel_region {
+    int x0, y0, x1, y1;
+
+    int pixel_count() const { return std::max(0, x1 - x0) * std::max(0, y1 - y0); }
+};
+
+struct render_settings {
+    int samples_per_pixel = 20;
+    int threads = 0;     // 0 = número de núcleos da máquina
+    int tile_size = 16;
+    bool frustum_culling = true; // Raios primários de cada tile só testam o que está na pirâmide do tile
+    trace_settings trace;
+};
+
+inline int resolve_thread_count(int requested) {
+    if (requested > 0) return requested;
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? static_cast<int>(n) : 1;
+}
+
+// Divide a região em tiles e distribui entre as threads: cada thread pega o próximo tile
+// livre num contador atômico (balanceamento dinâmico, tiles caros não travam os outros).
+// fn(tile) é chamada uma vez por tile, possivelmente em paralelo.
+// Com o trace ligado, cada tile vira um evento 'trace_name' e a espera da thread que chamou pelas
+// outras vira "join" (threads ociosas no fim do frame aparecem como esse trecho).
+template <typename TileFn>
+void parallel_tiles(const pixel_region& region, int tile_size, int threads, TileFn fn,
+                    const char* trace_name = "tile") {
+    int tiles_x = (region.x1 - region.x0 + tile_size - 1) / tile_size;
+    int tiles_y = (region.y1 - region.y0 + tile_size - 1) / tile_size;
+    int tile_count = std::max(0, tiles_x) * std::max(0, tiles_y);
+    if (tile_count == 0) return;
+
+    std::atomic<int> next_tile{0};
+    auto worker = [&]() {
+        for (int t = next_tile++; t < tile_count; t = next_tile++) {
+            // Começa pelo topo da imagem, na mesma ordem do loop original
+            int ty = tiles_y - 1 - t / tiles_x;
+            int tx = t % tiles_x;
+            pixel_region tile;
+            tile.x0 = region.x0 + tx * tile_size;
+            tile.y0 = region.y0 + ty * tile_size;
+            tile.x1 = std::min(tile.x0 + tile_size, region.x1);
+            tile.y1 = std::min(tile.y0 + tile_size, region.y1);
+            trace_scope scope(trace_name, "tile", tile.x0, tile.y0);
+            fn(tile);
+        }
+    };
+
+    int n = std::min(resolve_thread_count(threads), tile_count);
+    std::vector<std::thread> pool;
+    for (int k = 1; k < n; k++) pool.emplace_back(worker);
+    worker();
+    trace_scope join_scope("join", "tile");
+    for (auto& th : pool) th.join();
+}
+
+// Soma de 'count' amostras do pixel (i, j) numa imagem width x height.
+// Com 'aov_sum', soma também os AOVs do hit primário de cada amostra.
+inline color sample_pixel(const camera& cam, const hittable& world, const std::vector<PointLight>& lights,
+                          int i, int j, int width, int height, int count,
+                          const trace_settings& trace, ray_stats& stats, shadow_cache& shadows,
+                          aov_sample* aov_sum = nullptr) {
+    color sum(0, 0, 0);
+    aov_sample aov;
+    double spread = cam.pixel_spread(height);
+    for (int s = 0; s < count; ++s) {
+        auto u = (i + random_double()) / (width-1);
+        auto v = (j + random_double()) / (height-1);
+        ray r = cam.get_ray(u, v);
+        r.spread = spread;
+        color c = ray_color(r, world, lights, trace, stats, shadows, 0, color(1,1,1), aov_sum ? &aov : nullptr);
+        sum += c;
+        if (aov_sum) {
+            aov.luminance2 = luminance(c) * luminance(c);
+            *aov_sum += aov;
+        }
+    }
+    return sum;
+}
+
+// Completa cada pixel do tile até 'target_spp' amostras (pixels já prontos não custam nada), com o
+// culling por tile dos raios primários. Retorna quantas amostras novas foram traçadas.
+inline long render_tile(const camera& cam, const hittable& world, const std::vector<PointLight>& lights,
+                        framebuffer& fb, const pixel_region& tile, int target_spp,
+                        const render_settings& settings, ray_stats& tile_stats, shadow_cache& tile_shadows) {
+    long local = 0;
+    tile_candidates candidates(world);
+    const hittable* tile_world = &world;
+    if (settings.frustum_culling && candidates.build(cam, tile.x0, tile.y0, tile.x1, tile.y1, fb.width, fb.height)) {
+        tile_world = &candidates;
+        tile_stats.culled_tiles++;
+        tile_stats.tile_candidates += static_cast<long>(candidates.candidate_count());
+    }
+    for (int j = tile.y1-1; j >= tile.y0; --j) {
+        for (int i = tile.x0; i < tile.x1; ++i) {
+            size_t k = fb.index(i, j);
+            int missing = target_spp - fb.samples[k];
+            if (missing <= 0) continue;
+            aov_sample aov;
+            fb.accum[k] += sample_pixel(cam, *tile_world, lights, i, j, fb.width, fb.height, missing,
+                                        settings.trace, tile_stats, tile_shadows,
+                                        fb.has_aovs() ? &aov : nullptr);
+            if (fb.has_aovs()) {
+                fb.albedo_sum[k] += aov.albedo;
+                fb.normal_sum[k] += aov.normal;
+                fb.depth_sum[k] += aov.depth;
+                fb.aov_samples[k] += missing;
+                fb.luminance2_sum[k] += aov.luminance2;
+            }
+            fb.samples[k] += missing;
+            local += missing;
+        }
+    }
+    return local;
+}
+
+// Completa cada pixel da região até 'target_spp' amostras, tile a tile em paralelo.
+// Retorna quantas amostras novas foram traçadas; se 'stats' não for nulo, soma nele os raios por profundidade.
+inline long render_region(const camera& cam, const hittable& world, const std::vector<PointLight>& lights,
+                          framebuffer& fb, const pixel_region& region, int target_spp,
+                          const render_settings& settings, bool show_progress = false,
+                          ray_stats* stats = nullptr) {
+    std::atomic<long> traced{0};
+    std::atomic<int> tiles_done{0};
+    std::mutex log_mutex;
+    int tiles_total = ((region.x1 - region.x0 + settings.tile_size - 1) / settings.tile_size)
+                    * ((region.y1 - region.y0 + settings.tile_size - 1) / settings.tile_size);
+
+    parallel_tiles(region, settings.tile_size, settings.threads, [&](const pixel_region& tile) {
+        ray_stats tile_stats;
+        shadow_cache tile_shadows;
+        traced += render_tile(cam, world, lights, fb, tile, target_spp, settings, tile_stats, tile_shadows);
+        if (stats) {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            stats->add(tile_stats);
+        }
+
+        int done = ++tiles_done;
+        if (show_progress && (done % 50 == 0 || done == tiles_total)) {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            std::cerr << "\rTiles restantes: " << tiles_total - done << ' ' << std::flush;
+        }
+    });
+
+    return traced;
+}
+
+// Completa os AOVs da região até 'target_spp' amostras traçando só raios primários (sem luzes,
+// sombras ou reflexos): guias do denoiser com bem mais amostras que a cor, a um custo pequeno.
+inline void render_aov_region(const camera& cam, const hittable& world, framebuffer& fb,
+                              const pixel_region& region, int target_spp, const render_settings& settings) {
+    if (!fb.has_aovs()) return;
+    double spread = cam.pixel_spread(fb.height);
+    parallel_tiles(region, settings.tile_size, settings.threads, [&](const pixel_region& tile) {
+        for (int j = tile.y0; j < tile.y1; ++j) {
+            for (int i = tile.x0; i < tile.x1; ++i) {
+                size_t k = fb.index(i, j);
+                for (int s = fb.aov_samples[k]; s < target_spp; ++s) {
+                    auto u = (i + random_double()) / (fb.width-1);
+                    auto v = (j + random_double()) / (fb.height-1);
+                    ray r = cam.get_ray(u, v);
+                    r.spread = spread;
+                    hit_record rec;
+                    aov_sample aov = world.hit(r, 0.001, infinity, rec)
+                                   ? make_aov(r, rec, surface_albedo(r, rec, world)) : make_aov(r);
+                    fb.albedo_sum[k] += aov.albedo;
+                    fb.normal_sum[k] += aov.normal;
+                    fb.depth_sum[k] += aov.depth;
+                    fb.aov_samples[k]++;
+                }
+            }
+        }
+    }, "aov");
+}
+
+// Imagem inteira
+inline long render_frame(const camera& cam, const hittable& world, const std::vector<PointLight>& lights,
+                         framebuffer& fb, const render_settings& settings, bool show_progress = false,
+                         ray_stats* stats = nullptr) {
+    pixel_region all{0, 0, fb.width, fb.height};
+    return render_region(cam, world, lights, fb, all, settings.samples_per_pixel, settings, show_progress, stats);
+}
+
+#endif
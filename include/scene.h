@@ -0,0 +1,65 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "utils.h"
+#include "hittable_list.h"
+#include "bvh.h"
+#include "camera.h"
+#include "material.h"
+#include "arena.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// --- Definição de Luz (Pontual) ---
+struct PointLight {
+    point3 position;
+    color intensity;
+};
+
+// Parâmetros de visada da câmera (o que o usuário edita: Eye, At, Up e zoom)
+struct view_params {
+    point3 lookfrom;
+    point3 lookat;
+    vec3 vup;
+    double vfov;
+    double aperture = 0.0;
+
+    camera make_camera(double aspect_ratio) const {
+        auto dist_to_focus = (lookfrom - lookat).length();
+        return camera(lookfrom, lookat, vup, vfov, aspect_ratio, aperture, dist_to_focus);
+    }
+};
+
+// Tudo o que o renderer precisa para desenhar um quadro
+class scene {
+    public:
+        // Dona de geometria, materiais e texturas criados com arena.make<T>(...).
+        // Declarada primeiro para ser destruída por último.
+        scene_arena arena;
+
+        hittable_list world;
+        shared_ptr<bvh> accel;
+        std::vector<PointLight> lights;
+        view_params view;
+
+        // Materiais com nome, para edição em tempo de execução (sessão, relighting)
+        std::map<std::string, shared_ptr<material>> materials;
+
+        // Monta a BVH sobre os objetos de 'world' (chamar depois de adicionar tudo)
+        void build_accel() { accel = make_shared<bvh>(world); }
+
+        shared_ptr<material> add_material(const std::string& name, shared_ptr<material> mat) {
+            materials[name] = mat;
+            return mat;
+        }
+
+        // Raiz da interseção: a BVH se existir, senão a lista linear
+        const hittable& root() const {
+            if (accel) return *accel;
+            return world;
+        }
+};
+
+#endif
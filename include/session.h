@@ -0,0 +1,317 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "utils.h"
+#include "scene.h"
+#include "renderer.h"
+#include "framebuffer.h"
+#include "relight.h"
+#include "budget.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// --- Sessão de Render Persistente ---
+//
+// Mantém cena, BVH e framebuffer carregados entre comandos, para que editar a câmera
+// (zoom, Eye/At) ou fazer picking não exija rodar o programa de novo.
+// Cada comando é uma linha de texto; cada resposta é uma linha começando com "ok" ou "erro".
+//
+//   lookfrom x y z | lookat x y z | vup x y z   Move a câmera
+//   fov graus | zoom fator                      Campo de visão (zoom > 1 aproxima)
+//   resolution largura altura                   Realoca o framebuffer
+//   spp n                                       Amostras por pixel do render final
+//   preview                                     1 amostra por pixel (resposta rápida)
+//   render [x0 y0 x1 y1]                        Completa a região até spp amostras
+//   budget ms                                   Prévia que termina no prazo (ver budget.h)
+//   save arquivo.ppm                            Grava o framebuffer atual
+//   pick x y                                    Picking (mesma convenção do modo interativo)
+//   light k x y z | intensity k r g b           Move / muda a intensidade da luz k
+//   material nome ka shininess [ks_r ks_g ks_b] Edita um material com nome da cena
+//   optics nome kr kt [ior]                     Refletividade / transmissão (cinza) do material
+//   depth n                                     Profundidade máxima dos raios secundários
+//   relight on|off                              Liga o cache de relighting (ver relight.h)
+//   stats | quit
+//
+// Só o que mudou é refeito: editar a câmera descarta as amostras, mas a cena e a BVH
+// continuam prontas; renderizar de novo uma região já completa não custa nada.
+// Com relight ligado, editar luz ou material não retraça raios primários: o próximo
+// render só refaz o sombreamento (e as sombras das luzes que se moveram).
+class render_session {
+    public:
+        scene& sc;
+        view_params view;
+        render_settings settings;
+        framebuffer fb;
+        long total_samples = 0;
+        ray_stats rays; // Raios por profundidade desde o início da sessão
+
+        relight_cache relight;
+        bool relight_enabled = false;
+        bool shading_dirty = false; // Luz/material mudou desde o último sombreamento do cache
+
+        budget_state budget;         // Vazão medida, reaproveitada de uma prévia para a outra
+        bool budget_preview = false; // O framebuffer tem uma prévia ampliada, não amostras acumuláveis
+
+        render_session(scene& s, int width, int height, const render_settings& rs)
+            : sc(s), view(s.view), settings(rs), fb(width, height) {}
+
+        double aspect_ratio() const { return double(fb.width) / fb.height; }
+
+        // Câmera, resolução ou spp mudaram: amostras e cache de relighting não valem mais
+        void invalidate_view() {
+            fb.clear();
+            relight.samples.clear();
+        }
+
+        // Luz ou material mudou: com relighting basta sombrear de novo, senão descarta as amostras
+        void invalidate_shading() {
+            if (relight_enabled && relight.valid()) shading_dirty = true;
+            else fb.clear();
+        }
+
+        // Lê comandos até "quit" ou fim do fluxo
+        void run(std::istream& in, std::ostream& out) {
+            std::string line;
+            while (std::getline(in, line)) {
+                bool keep_going = true;
+                out << execute(line, keep_going) << '\n' << std::flush;
+                if (!keep_going) break;
+            }
+        }
+
+        // Executa um comando e devolve a linha de resposta
+        std::string execute(const std::string& line, bool& keep_going) {
+            using clock = std::chrono::steady_clock;
+            std::istringstream args(line);
+            std::string cmd;
+            if (!(args >> cmd)) return "ok";
+
+            std::ostringstream reply;
+            auto start = clock::now();
+
+            if (cmd == "quit" || cmd == "exit") {
+                keep_going = false;
+                return "ok tchau";
+            } else if (cmd == "lookfrom" || cmd == "lookat" || cmd == "vup") {
+                double x, y, z;
+                if (!(args >> x >> y >> z)) return "erro uso: " + cmd + " x y z";
+                vec3& target = cmd == "lookfrom" ? view.lookfrom : cmd == "lookat" ? view.lookat : view.vup;
+                target = vec3(x, y, z);
+                invalidate_view();
+                reply << "ok";
+            } else if (cmd == "fov" || cmd == "zoom") {
+                double value;
+                if (!(args >> value) || value <= 0) return "erro uso: " + cmd + " valor_positivo";
+                view.vfov = cmd == "fov" ? value : view.vfov / value;
+                view.vfov = clamp(view.vfov, 1.0, 179.0);
+                invalidate_view();
+                reply << "ok vfov " << view.vfov;
+            } else if (cmd == "resolution") {
+                int w, h;
+                if (!(args >> w >> h) || w < 2 || h < 2) return "erro uso: resolution largura altura";
+                fb.resize(w, h);
+                relight.samples.clear();
+                reply << "ok " << w << "x" << h;
+            } else if (cmd == "spp") {
+                int n;
+                if (!(args >> n) || n < 1) return "erro uso: spp n";
+                settings.samples_per_pixel = n;
+                relight.samples.clear();
+                reply << "ok spp " << n;
+            } else if (cmd == "render" && relight_enabled) {
+                // Relighting trabalha sempre com a imagem inteira
+                bool need_shade = shading_dirty || budget_preview || fb.samples[0] != relight.spp;
+                budget_preview = false;
+                if (!relight.valid()) {
+                    need_shade = true;
+                    relight.build(view.make_camera(aspect_ratio()), sc, fb.width, fb.height,
+                                  settings.samples_per_pixel, settings);
+                    total_samples += relight.primary_rays;
+                    reply << "ok render cache primarias " << relight.primary_rays
+                          << " sombras " << relight.shadow_rays << " cache_sombra " << relight.shadow_cache_hits;
+                } else if (shading_dirty) {
+                    relight.update_lights(sc, settings);
+                    reply << "ok render relight luzes_retracadas " << relight.lights_retraced
+                          << " sombras " << relight.shadow_rays << " cache_sombra " << relight.shadow_cache_hits;
+                } else {
+                    reply << "ok render sem mudancas";
+                }
+                if (need_shade) {
+                    relight.shade(sc, fb, settings, &rays);
+                    if (relight.secondary_rays > 0) reply << " secundarios " << relight.secondary_rays;
+                }
+                shading_dirty = false;
+            } else if (cmd == "budget") {
+                double ms;
+                if (!(args >> ms) || ms <= 0) return "erro uso: budget ms";
+                budget_settings bs;
+                bs.budget_ms = ms;
+                bs.max_spp = settings.samples_per_pixel;
+                camera cam = view.make_camera(aspect_ratio());
+                budget_report br = render_budgeted(cam, sc.root(), sc.lights, fb, settings, bs, budget, &rays);
+                budget_preview = true;
+                total_samples += br.samples;
+                reply << "ok budget " << br.width << "x" << br.height << " passadas " << br.passes
+                      << " amostras " << br.samples << " cobertura " << br.coverage;
+            } else if (cmd == "preview" || cmd == "render") {
+                if (budget_preview) {
+                    fb.clear();
+                    budget_preview = false;
+                }
+                pixel_region region{0, 0, fb.width, fb.height};
+                int x0, y0, x1, y1;
+                if (cmd == "render" && (args >> x0 >> y0 >> x1 >> y1)) {
+                    region = pixel_region{std::max(0, x0), std::max(0, y0),
+                                          std::min(fb.width, x1), std::min(fb.height, y1)};
+                }
+                int target = cmd == "preview" ? 1 : settings.samples_per_pixel;
+                camera cam = view.make_camera(aspect_ratio());
+                long traced = render_region(cam, sc.root(), sc.lights, fb, region, target, settings, false, &rays);
+                total_samples += traced;
+                reply << "ok " << cmd << " amostras " << traced;
+            } else if (cmd == "save") {
+                std::string path;
+                if (!(args >> path)) return "erro uso: save arquivo.ppm";
+                std::ofstream file(path);
+                if (!file) return "erro nao foi possivel abrir " + path;
+                fb.write_ppm(file);
+                reply << "ok " << path;
+            } else if (cmd == "pick") {
+                int x, y;
+                if (!(args >> x >> y) || x < 0 || x >= fb.width || y < 0 || y >= fb.height)
+                    return "erro uso: pick x y (dentro da imagem)";
+                camera cam = view.make_camera(aspect_ratio());
+                ray r = cam.get_ray(double(x) / (fb.width - 1), double(y) / (fb.height - 1));
+                hit_record rec;
+                if (sc.root().hit(r, 0.001, infinity, rec))
+                    reply << "ok hit p " << rec.p << " n " << rec.normal << " t " << rec.t
+                          << " uv " << rec.u << ' ' << rec.v;
+                else
+                    reply << "ok fundo";
+            } else if (cmd == "light" || cmd == "intensity") {
+                int k;
+                double x, y, z;
+                if (!(args >> k >> x >> y >> z) || k < 0 || k >= static_cast<int>(sc.lights.size()))
+                    return "erro uso: " + cmd + " indice_da_luz x y z";
+                if (cmd == "light") sc.lights[k].position = point3(x, y, z);
+                else sc.lights[k].intensity = color(x, y, z);
+                invalidate_shading();
+                reply << "ok";
+            } else if (cmd == "material") {
+                std::string name;
+                double ka, shininess;
+                if (!(args >> name >> ka >> shininess)) return "erro uso: material nome ka shininess [ks_r ks_g ks_b]";
+                auto it = sc.materials.find(name);
+                if (it == sc.materials.end()) return "erro material desconhecido: " + name;
+                it->second->ka = ka;
+                it->second->shininess = shininess;
+                double r, g, b;
+                if (args >> r >> g >> b) it->second->ks = vec3(r, g, b);
+                invalidate_shading();
+                reply << "ok";
+            } else if (cmd == "optics") {
+                std::string name;
+                double kr, kt, ior;
+                if (!(args >> name >> kr >> kt)) return "erro uso: optics nome kr kt [ior]";
+                auto it = sc.materials.find(name);
+                if (it == sc.materials.end()) return "erro material desconhecido: " + name;
+                it->second->kr = color(kr, kr, kr);
+                it->second->kt = color(kt, kt, kt);
+                if (args >> ior && ior > 0) it->second->ior = ior;
+                invalidate_shading();
+                reply << "ok";
+            } else if (cmd == "depth") {
+                int n;
+                if (!(args >> n) || n < 1) return "erro uso: depth n";
+                settings.trace.max_depth = n;
+                fb.clear();
+                reply << "ok depth " << n;
+            } else if (cmd == "relight") {
+                std::string mode;
+                args >> mode;
+                relight_enabled = mode != "off";
+                if (!relight_enabled) relight.samples.clear();
+                reply << "ok relight " << (relight_enabled ? "on" : "off");
+            } else if (cmd == "stats") {
+                reply << "ok " << fb.width << "x" << fb.height << " spp " << settings.samples_per_pixel
+                      << " vfov " << view.vfov << " amostras_total " << total_samples
+                      << " cache_relight_mb " << relight.memory_bytes() / (1024.0 * 1024.0) << " raios ";
+                rays.print(reply);
+            } else {
+                return "erro comando desconhecido: " + cmd;
+            }
+
+            reply << " (" << std::chrono::duration<double, std::milli>(clock::now() - start).count() << " ms)";
+            return reply.str();
+        }
+};
+
+#ifndef _WIN32
+// Envia a resposta inteira; MSG_NOSIGNAL evita que um cliente que desconectou
+// derrube o servidor com SIGPIPE (falha vira só "false")
+inline bool session_send_all(int fd, const std::string& data) {
+    const char* p = data.data();
+    size_t size = data.size();
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Atende a sessão num socket Unix local: uma conexão por vez, um comando por linha.
+// A sessão (cena, framebuffer) continua viva entre conexões; "quit" encerra o servidor.
+inline bool serve_unix_socket(render_session& session, const std::string& path) {
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) return false;
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path.c_str());
+    unlink(path.c_str());
+    if (bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(server, 4) < 0) {
+        close(server);
+        return false;
+    }
+    std::cerr << "Sessao escutando em " << path << "\n";
+
+    bool keep_going = true;
+    while (keep_going) {
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0) break;
+
+        std::string pending;
+        char buffer[4096];
+        ssize_t n;
+        bool connected = true;
+        while (connected && keep_going && (n = read(client, buffer, sizeof(buffer))) > 0) {
+            pending.append(buffer, n);
+            size_t eol;
+            while (connected && keep_going && (eol = pending.find('\n')) != std::string::npos) {
+                std::string reply = session.execute(pending.substr(0, eol), keep_going) + "\n";
+                pending.erase(0, eol + 1);
+                connected = session_send_all(client, reply);
+            }
+        }
+        close(client);
+    }
+
+    close(server);
+    unlink(path.c_str());
+    return true;
+}
+#endif
+
+#endif
@@ -41,11 +41,17 @@ class sphere : public hittable {
             
             rec.set_face_normal(r, outward_normal);
             get_sphere_uv(outward_normal, rec.u, rec.v); // Calcula textura
-            rec.mat_ptr = mat_ptr;
+            rec.mat_ptr = mat_ptr.get();
 
             return true;
         }
 
+        virtual bool bounding_box(aabb& output_box) const override {
+            vec3 r(radius, radius, radius);
+            output_box = aabb(center - r, center + r);
+            return true;
+        }
+
     private:
         static void get_sphere_uv(const point3& p, double& u, double& v) {
             auto theta = acos(-p.y());
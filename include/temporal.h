@@ -0,0 +1,220 @@
+#ifndef TEMPORAL_H
+#define TEMPORAL_H
+
+#include "utils.h"
+#include "renderer.h"
+#include "framebuffer.h"
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+// --- Reaproveitamento Temporal entre Quadros ---
+//
+// Numa sequência com câmera e objetos se movendo devagar, cada quadro começava do zero.
+// Aqui cada pixel do quadro novo procura onde a sua superfície estava no quadro anterior:
+//   1. Um raio pelo centro do pixel dá o ponto p, a normal e o objeto atingido.
+//   2. Vetor de movimento: se o objeto é animado, p volta para a posição do quadro anterior
+//      (motion = M_anterior * M_atual^-1, ver scene_animation::motion_between).
+//   3. p anterior é projetado na câmera anterior e o histórico é lido com peso bilinear nos
+//      4 pixels vizinhos. Cada vizinho é recusado se a profundidade (relativa) ou a normal
+//      guardadas não baterem: superfície que estava escondida (desoclusão) não herda nada.
+//   4. Pixel com histórico recebe só 'fresh_spp' amostras novas; sem histórico (ou fundo)
+//      recebe o spp cheio. O histórico é limitado a 'max_history' amostras, para que
+//      mudanças de iluminação sumam em poucos quadros.
+//   5. A média herdada é presa ao min/max das médias novas da vizinhança 3x3, para que
+//      sombras e reflexos que se moveram sobre uma superfície parada não deixem rastro.
+
+struct temporal_settings {
+    int fresh_spp = 4;
+    int max_history = 32;
+    double depth_tolerance = 0.02; // Diferença relativa de profundidade aceita
+    double normal_tolerance = 0.9; // Cosseno mínimo entre as normais
+};
+
+struct temporal_stats {
+    long reused = 0;           // Pixels que herdaram amostras
+    long rejected = 0;         // Pixels com todos os vizinhos recusados (profundidade/normal)
+    long offscreen = 0;        // Ponto anterior fora da tela ou atrás da câmera
+    long background = 0;       // Fundo (sempre retraçado)
+    long clamped = 0;          // Pixels reaproveitados cuja média foi presa à vizinhança nova
+    long samples = 0;          // Amostras novas traçadas
+};
+
+class temporal_history {
+    public:
+        int width = 0;
+        int height = 0;
+        camera cam = camera(point3(0,0,1), point3(0,0,0), vec3(0,1,0), 90, 1);
+        std::vector<color> sum;     // Soma das amostras (linear) do quadro anterior
+        std::vector<float> count;   // Amostras somadas (pode ser fracionário depois da mistura)
+        std::vector<float> depth;   // Distância da câmera ao ponto do centro do pixel (0 = fundo)
+        std::vector<vec3> normal;
+
+        bool valid() const { return !sum.empty(); }
+        void reset() { sum.clear(); }
+};
+
+// Renderiza um quadro em 'fb' reaproveitando 'history' (que sai atualizado para o próximo quadro)
+inline temporal_stats render_temporal_frame(const camera& cam, const hittable& world, const std::vector<PointLight>& lights,
+                                            framebuffer& fb, const render_settings& settings,
+                                            const temporal_settings& ts, temporal_history& history,
+                                            const std::unordered_map<const hittable*, mat4>& motion) {
+    int w = fb.width, h = fb.height;
+    size_t n = static_cast<size_t>(w) * h;
+    bool reuse = history.valid() && history.width == w && history.height == h;
+
+    // Passo 1: histórico reprojetado (média + contagem) e amostras novas, separados
+    std::vector<color> hist_mean(n), fresh_sum(n);
+    std::vector<float> hist_count(n, 0.0f), next_depth(n);
+    std::vector<int> fresh_count(n);
+    std::vector<vec3> next_normal(n);
+    std::atomic<long> reused{0}, rejected{0}, offscreen{0}, background{0}, traced{0}, clamped{0};
+
+    pixel_region all{0, 0, w, h};
+    parallel_tiles(all, settings.tile_size, settings.threads, [&](const pixel_region& tile) {
+        ray_stats stats;
+        shadow_cache shadows;
+        long local_reused = 0, local_rejected = 0, local_offscreen = 0, local_background = 0, local_traced = 0;
+        for (int j = tile.y0; j < tile.y1; ++j) {
+            for (int i = tile.x0; i < tile.x1; ++i) {
+                size_t k = fb.index(i, j);
+                ray r = cam.get_ray((i + 0.5) / (w-1), (j + 0.5) / (h-1));
+                hit_record rec;
+
+                if (!world.hit(r, 0.001, infinity, rec)) {
+                    next_depth[k] = 0.0f;
+                    next_normal[k] = vec3(0, 0, 0);
+                    local_background++;
+                } else {
+                    vec3 normal = unit_vector(rec.normal);
+                    next_depth[k] = static_cast<float>(rec.t * r.direction().length());
+                    next_normal[k] = normal;
+
+                    if (reuse) {
+                        // Onde este ponto estava no quadro anterior
+                        point3 p_prev = rec.p;
+                        vec3 n_prev = normal;
+                        auto it = motion.find(rec.object);
+                        if (it != motion.end()) {
+                            p_prev = (it->second * vec4(rec.p, 1.0)).to_vec3();
+                            n_prev = unit_vector((it->second * vec4(normal, 0.0)).to_vec3());
+                        }
+
+                        double s, t;
+                        double x = -1, y = -1;
+                        if (history.cam.project(p_prev, s, t)) {
+                            x = s * (w-1) - 0.5;
+                            y = t * (h-1) - 0.5;
+                        }
+                        if (x < -0.5 || y < -0.5 || x > w - 0.5 || y > h - 0.5) {
+                            local_offscreen++;
+                        } else {
+                            double prev_depth = (p_prev - history.cam.origin).length();
+                            int x0 = static_cast<int>(floor(x)), y0 = static_cast<int>(floor(y));
+                            double fx = x - x0, fy = y - y0;
+                            color mean(0, 0, 0);
+                            double count = 0.0, weight_sum = 0.0;
+                            for (int tap = 0; tap < 4; tap++) {
+                                int xi = x0 + (tap & 1), yi = y0 + (tap >> 1);
+                                if (xi < 0 || yi < 0 || xi >= w || yi >= h) continue;
+                                size_t q = static_cast<size_t>(yi) * w + xi;
+                                if (history.count[q] <= 0 || history.depth[q] <= 0) continue;
+                                if (fabs(history.depth[q] - prev_depth) > ts.depth_tolerance * prev_depth) continue;
+                                if (dot(history.normal[q], n_prev) < ts.normal_tolerance) continue;
+                                double wt = ((tap & 1) ? fx : 1 - fx) * ((tap >> 1) ? fy : 1 - fy);
+                                mean += wt * history.sum[q] / history.count[q];
+                                count += wt * history.count[q];
+                                weight_sum += wt;
+                            }
+                            if (weight_sum > 1e-6) {
+                                hist_mean[k] = mean / weight_sum;
+                                hist_count[k] = static_cast<float>(std::min(count / weight_sum, double(ts.max_history)));
+                                local_reused++;
+                            } else {
+                                local_rejected++;
+                            }
+                        }
+                    }
+                }
+
+                int fresh = hist_count[k] > 0 ? ts.fresh_spp : settings.samples_per_pixel;
+                fresh_sum[k] = sample_pixel(cam, world, lights, i, j, w, h, fresh, settings.trace, stats, shadows);
+                fresh_count[k] = fresh;
+                local_traced += fresh;
+            }
+        }
+        reused += local_reused;
+        rejected += local_rejected;
+        offscreen += local_offscreen;
+        background += local_background;
+        traced += local_traced;
+    }, "temporal.reproject");
+
+    // Passo 2: a média herdada é presa à caixa (min/max) das médias novas da vizinhança 3x3.
+    // A geometria bate mas a iluminação pode ter mudado (sombra que andou): sem isso a sombra
+    // antiga fica como um rastro por 'max_history' quadros.
+    std::vector<color> next_sum(n);
+    std::vector<float> next_count(n);
+    parallel_tiles(all, settings.tile_size, settings.threads, [&](const pixel_region& tile) {
+        long local_clamped = 0;
+        for (int j = tile.y0; j < tile.y1; ++j) {
+            for (int i = tile.x0; i < tile.x1; ++i) {
+                size_t k = fb.index(i, j);
+                color sum = fresh_sum[k];
+                double count = fresh_count[k];
+                if (hist_count[k] > 0) {
+                    color lo(infinity, infinity, infinity), hi(-infinity, -infinity, -infinity);
+                    for (int dj = -1; dj <= 1; dj++) {
+                        for (int di = -1; di <= 1; di++) {
+                            int xi = i + di, yi = j + dj;
+                            if (xi < 0 || yi < 0 || xi >= w || yi >= h) continue;
+                            size_t q = fb.index(xi, yi);
+                            color m = fresh_sum[q] / fresh_count[q];
+                            for (int c = 0; c < 3; c++) {
+                                lo.e[c] = std::min(lo.e[c], m.e[c]);
+                                hi.e[c] = std::max(hi.e[c], m.e[c]);
+                            }
+                        }
+                    }
+                    color mean = hist_mean[k];
+                    bool moved = false;
+                    for (int c = 0; c < 3; c++) {
+                        double v = std::min(std::max(mean.e[c], lo.e[c]), hi.e[c]);
+                        if (v != mean.e[c]) moved = true;
+                        mean.e[c] = v;
+                    }
+                    if (moved) local_clamped++;
+                    sum += hist_count[k] * mean;
+                    count += hist_count[k];
+                }
+
+                next_sum[k] = sum;
+                next_count[k] = static_cast<float>(count);
+                // O framebuffer recebe a média (como uma amostra) para write_ppm/resolve
+                fb.accum[k] = sum / count;
+                fb.samples[k] = 1;
+            }
+        }
+        clamped += local_clamped;
+    }, "temporal.merge");
+
+    history.width = w;
+    history.height = h;
+    history.cam = cam;
+    history.sum.swap(next_sum);
+    history.count.swap(next_count);
+    history.depth.swap(next_depth);
+    history.normal.swap(next_normal);
+
+    temporal_stats out;
+    out.reused = reused;
+    out.rejected = rejected;
+    out.offscreen = offscreen;
+    out.background = background;
+    out.clamped = clamped;
+    out.samples = traced;
+    return out;
+}
+
+#endif
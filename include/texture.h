@@ -6,9 +6,22 @@
 
 using namespace std;
 
+// Pegada de um raio no ponto atingido: largura aproximada da área que um pixel cobre ali
+struct texture_footprint {
+    double uv = 0.0;    // Em coordenadas de textura (u, v)
+    double world = 0.0; // Em unidades do mundo
+};
+
 class texture {
     public:
         virtual color value(double u, double v, const point3& p) const = 0;
+
+        // Amostra filtrada pela pegada do raio (texturas com mip-maps, ver image_texture.h).
+        // Só é chamada se uses_footprint() for verdadeiro: medir a pegada custa dois raios extras.
+        virtual color filtered_value(double u, double v, const point3& p, const texture_footprint& /*fp*/) const {
+            return value(u, v, p);
+        }
+        virtual bool uses_footprint() const { return false; }
 };
 
 // Cor Sólida (para compatibilidade com o que já tínhamos)
@@ -45,6 +58,14 @@ class checker_texture : public texture {
             else
                 return even->value(u, v, p);
         }
+
+        virtual color filtered_value(double u, double v, const point3& p, const texture_footprint& fp) const override {
+            auto sines = sin(10*p.x()) * sin(10*p.y()) * sin(10*p.z());
+            const texture& t = sines < 0 ? *odd : *even;
+            return t.uses_footprint() ? t.filtered_value(u, v, p, fp) : t.value(u, v, p);
+        }
+
+        virtual bool uses_footprint() const override { return odd->uses_footprint() || even->uses_footprint(); }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,195 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// --- Linha do Tempo (Chrome trace events) ---
+//
+// Contadores agregados (ray_stats, tempos no log) não mostram threads paradas esperando o último
+// tile nem quanto tempo a escrita da imagem trava o main(). Com o trace ligado (--trace), cada
+// trace_scope grava um evento "X" (início + duração) no buffer circular da própria thread:
+//   - gravar não usa trava nem atômicos compartilhados: só a thread dona escreve no buffer e
+//     publica o índice com release. A trava só aparece quando uma thread pega o seu buffer pela
+//     primeira vez (e quando devolve, ao terminar).
+//   - buffer cheio sobrescreve os eventos mais antigos (contados em dropped()).
+//   - parallel_tiles cria threads novas a cada chamada: o buffer de uma thread que terminou volta
+//     para uma lista livre e é reaproveitado pela próxima, então cada linha do trace é um
+//     "trabalhador" e não uma thread do sistema.
+// write_json() grava o formato JSON do Chrome (abrir em about:tracing ou ui.perfetto.dev); deve ser
+// chamado com as threads de render já encerradas. Desligado, um trace_scope custa uma leitura atômica.
+
+struct trace_event {
+    const char* name;     // Literal (só o ponteiro é guardado)
+    const char* category;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    int32_t x, y;         // Argumentos opcionais (tile: canto inferior esquerdo); -1 = sem
+};
+
+class trace_buffer {
+    public:
+        uint32_t tid;
+        std::string thread_name;
+        std::vector<trace_event> events;
+        std::atomic<uint64_t> written{0};
+
+        trace_buffer(uint32_t id, size_t capacity) : tid(id), events(capacity) {}
+
+        void push(const trace_event& e) {
+            uint64_t k = written.load(std::memory_order_relaxed);
+            events[k % events.size()] = e;
+            written.store(k + 1, std::memory_order_release);
+        }
+};
+
+class trace_recorder {
+    public:
+        static trace_recorder& global() {
+            static trace_recorder recorder;
+            return recorder;
+        }
+
+        void enable(size_t events_per_thread = size_t(1) << 16) {
+            std::lock_guard<std::mutex> lock(mutex);
+            capacity = events_per_thread;
+            origin = std::chrono::steady_clock::now();
+            on.store(true, std::memory_order_release);
+        }
+
+        bool enabled() const { return on.load(std::memory_order_relaxed); }
+
+        uint64_t now_ns() const {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - origin).count());
+        }
+
+        void record(const char* name, const char* category, uint64_t start_ns, uint64_t end_ns,
+                    int32_t x = -1, int32_t y = -1) {
+            local_buffer()->push(trace_event{name, category, start_ns, end_ns - start_ns, x, y});
+        }
+
+        // Nome da linha da thread atual no trace (senão "worker N")
+        void name_thread(const char* name) {
+            if (!enabled()) return;
+            trace_buffer* buffer = local_buffer();
+            std::lock_guard<std::mutex> lock(mutex);
+            buffer->thread_name = name;
+        }
+
+        long dropped() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            long lost = 0;
+            for (const auto& b : buffers) {
+                uint64_t n = b->written.load(std::memory_order_acquire);
+                if (n > b->events.size()) lost += static_cast<long>(n - b->events.size());
+            }
+            return lost;
+        }
+
+        // Grava o JSON; retorna o número de eventos escritos (-1 se não conseguiu abrir)
+        long write_json(const char* path) const {
+            FILE* out = std::fopen(path, "w");
+            if (!out) return -1;
+            std::lock_guard<std::mutex> lock(mutex);
+            long count = 0;
+            std::fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+            bool first = true;
+            for (const auto& b : buffers) {
+                std::fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                             first ? "" : ",\n", b->tid,
+                             b->thread_name.empty() ? ("worker " + std::to_string(b->tid)).c_str() : b->thread_name.c_str());
+                first = false;
+
+                uint64_t n = b->written.load(std::memory_order_acquire);
+                uint64_t cap = b->events.size();
+                for (uint64_t k = n > cap ? n - cap : 0; k < n; k++) {
+                    const trace_event& e = b->events[k % cap];
+                    std::fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                                 e.name, e.category, b->tid, e.start_ns / 1000.0, e.duration_ns / 1000.0);
+                    if (e.x >= 0) std::fprintf(out, ",\"args\":{\"x\":%d,\"y\":%d}", e.x, e.y);
+                    std::fprintf(out, "}");
+                    count++;
+                }
+            }
+            std::fprintf(out, "\n]}\n");
+            std::fclose(out);
+            return count;
+        }
+
+    private:
+        // Buffer da thread: pego na primeira gravação, devolvido à lista livre quando a thread termina
+        struct thread_slot {
+            trace_buffer* buffer = nullptr;
+            ~thread_slot() {
+                if (buffer) trace_recorder::global().release(buffer);
+            }
+        };
+
+        std::atomic<bool> on{false};
+        std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+        size_t capacity = size_t(1) << 16;
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<trace_buffer>> buffers;
+        std::vector<trace_buffer*> free_buffers;
+
+        trace_buffer* local_buffer() {
+            static thread_local thread_slot slot;
+            if (!slot.buffer) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!free_buffers.empty()) {
+                    slot.buffer = free_buffers.back();
+                    free_buffers.pop_back();
+                } else {
+                    buffers.push_back(std::unique_ptr<trace_buffer>(
+                        new trace_buffer(static_cast<uint32_t>(buffers.size()), capacity)));
+                    slot.buffer = buffers.back().get();
+                }
+            }
+            return slot.buffer;
+        }
+
+        void release(trace_buffer* buffer) {
+            std::lock_guard<std::mutex> lock(mutex);
+            free_buffers.push_back(buffer);
+        }
+};
+
+// Marca o trecho entre a construção e a destruição (nome e categoria devem ser literais)
+class trace_scope {
+    public:
+        explicit trace_scope(const char* scope_name, const char* scope_category = "render",
+                             int32_t arg_x = -1, int32_t arg_y = -1)
+            : name(scope_name), category(scope_category), x(arg_x), y(arg_y),
+              active(trace_recorder::global().enabled()) {
+            if (active) start = trace_recorder::global().now_ns();
+        }
+
+        ~trace_scope() { end(); }
+
+        // Fecha o trecho antes do fim do escopo (trechos que não cabem num bloco, como a montagem da cena)
+        void end() {
+            if (!active) return;
+            active = false;
+            trace_recorder& tr = trace_recorder::global();
+            tr.record(name, category, start, tr.now_ns(), x, y);
+        }
+
+        trace_scope(const trace_scope&) = delete;
+        trace_scope& operator=(const trace_scope&) = delete;
+
+    private:
+        const char* name;
+        const char* category;
+        int32_t x, y;
+        bool active;
+        uint64_t start = 0;
+};
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <limits>
 #include <memory>
 #include <cstdlib>
@@ -18,11 +20,24 @@ inline double degrees_to_radians(double degrees) {
 
 // --- Geração de Números Aleatórios ---
 
+// Um gerador por thread: o render em tiles chama isto de várias threads ao mesmo tempo.
+// Cada thread recebe uma semente diferente (a primeira usa a semente padrão do mt19937).
+inline std::mt19937& random_generator() {
+    static std::atomic<unsigned> next_seed{0};
+    thread_local std::mt19937 generator(std::mt19937::default_seed + next_seed++);
+    return generator;
+}
+
 // Retorna um real aleatório em [0, 1)
 inline double random_double() {
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    static std::mt19937 generator;
-    return distribution(generator);
+    thread_local std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    return distribution(random_generator());
+}
+
+// Reinicia o gerador da thread atual: a sequência seguinte depende só de 'seed'
+// (ex: um tile retomado de um checkpoint sorteia as mesmas amostras de uma execução sem parada)
+inline void seed_random(uint32_t seed) {
+    random_generator().seed(seed);
 }
 
 // Retorna um real aleatório em [min, max)
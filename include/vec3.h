@@ -86,4 +86,18 @@ inline vec3 unit_vector(vec3 v) {
     return v / v.length();
 }
 
+// Reflexão de v em torno da normal unitária n
+inline vec3 reflect(const vec3& v, const vec3& n) {
+    return v - 2*dot(v, n)*n;
+}
+
+// Refração (Snell) de uv unitário; n aponta contra o raio e eta = n_origem / n_destino.
+// Só chamar quando não houver reflexão interna total.
+inline vec3 refract(const vec3& uv, const vec3& n, double eta) {
+    double cos_theta = fmin(dot(-uv, n), 1.0);
+    vec3 r_out_perp = eta * (uv + cos_theta*n);
+    vec3 r_out_parallel = -sqrt(fabs(1.0 - r_out_perp.length_squared())) * n;
+    return r_out_perp + r_out_parallel;
+}
+
 #endif
\ No newline at end of file
@@ -8,58 +8,35 @@
 #include "../include/material.h"
 #include "../include/instance.h"
 #include "../include/texture.h"
-
+#include "../include/bvh.h"
+#include "../include/animation.h"
+#include "../include/scene.h"
+#include "../include/framebuffer.h"
+#include "../include/renderer.h"
+#include "../include/session.h"
+#include "../include/distributed.h"
+#include "../include/instance_table.h"
+#include "../include/denoise.h"
+#include "../include/image_texture.h"
+#include "../include/baked_texture.h"
+#include "../include/budget.h"
+#include "../include/temporal.h"
+#include "../include/paged_mesh.h"
+#include "../include/trace.h"
+#include "../include/checkpoint.h"
+#include "../include/render_job.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <string>
 
-// --- Definição de Luz (Pontual) ---
-struct PointLight {
-    point3 position;
-    color intensity;
-};
-
-// --- Ray Casting (Blinn-Phong) ---
-color ray_color(const ray& r, const hittable& world, const PointLight& light) {
-    hit_record rec;
-
-    if (world.hit(r, 0.001, infinity, rec)) {
-        // Dados do Material
-        color color_diffuse = rec.mat_ptr->kd->value(rec.u, rec.v, rec.p);
-        vec3 color_specular = rec.mat_ptr->ks;
-        double shininess = rec.mat_ptr->shininess;
-
-        // A. Ambiental
-        color ambient = rec.mat_ptr->ka * color_diffuse;
-
-        // Vetores
-        vec3 light_dir = unit_vector(light.position - rec.p);
-        vec3 view_dir = unit_vector(-r.direction());
-        vec3 normal = unit_vector(rec.normal);
-
-        // B. Sombra (Shadow Ray)
-        ray shadow_ray(rec.p + 0.001*normal, light_dir);
-        hit_record shadow_rec;
-        double light_dist = (light.position - rec.p).length();
-
-        if (world.hit(shadow_ray, 0.001, light_dist, shadow_rec)) {
-            return ambient; 
-        }
-
-        // C. Difusa e Especular
-        double diff = fmax(dot(normal, light_dir), 0.0);
-        color diffuse = diff * color_diffuse;
-
-        vec3 halfway_dir = unit_vector(light_dir + view_dir);
-        double spec = pow(fmax(dot(normal, halfway_dir), 0.0), shininess);
-        color specular = spec * color_specular;
-
-        return ambient + (diffuse + specular) * light.intensity;
-    }
-
-    // Fundo
-    vec3 unit_direction = unit_vector(r.direction());
-    auto t = 0.5*(unit_direction.y() + 1.0);
-    return (1.0-t)*color(1.0, 1.0, 1.0) + t*color(0.5, 0.7, 1.0);
-}
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 // --- FUNÇÃO DE PICKING (Interatividade 5.1) ---
 // Recebe coordenadas de tela (pixel_x, pixel_y) e diz o que tem lá
@@ -89,89 +66,651 @@ void perform_pick(int x, int y, int width, int height, const camera& cam, const
     std::cerr << "------------------------------------------\n";
 }
 
-int main() {
+// Grava a linha do tempo do --trace (ver trace.h)
+static void write_trace(const char* path) {
+    long events = trace_recorder::global().write_json(path);
+    if (events < 0) {
+        std::cerr << "Trace: nao foi possivel gravar " << path << "\n";
+        return;
+    }
+    std::cerr << "Trace: " << events << " eventos em " << path << " ("
+              << trace_recorder::global().dropped() << " perdidos)\n";
+}
+
+// --- MODO ANIMAÇÃO (Turntable) ---
+// Só as transformações mudam entre quadros: a BVH é reajustada (refit) em vez de reconstruída.
+// Com 'temporal', cada quadro reaproveita as amostras do anterior (ver temporal.h).
+void render_animation(scene_animation& anim, scene& sc, double aspect_ratio,
+                      int image_width, int image_height, const render_settings& settings,
+                      int frames, const char* prefix, const temporal_settings* temporal = nullptr) {
+    using clock = std::chrono::steady_clock;
+    framebuffer fb(image_width, image_height);
+    temporal_history history;
+    long total_samples = 0;
+    auto sequence_start = clock::now();
+
+    for (int f = 0; f < frames; f++) {
+        trace_scope frame_scope("frame", "main", f, 0);
+        double time = frames > 1 ? double(f) / (frames - 1) : 0.0;
+        double prev_time = frames > 1 ? double(f - 1) / (frames - 1) : 0.0;
+
+        auto t0 = clock::now();
+        anim.apply(time, *sc.accel);
+        auto t1 = clock::now();
+
+        camera cam = anim.camera_at(time, aspect_ratio);
+        char filename[512];
+        std::snprintf(filename, sizeof(filename), "%s%04d.ppm", prefix, f);
+        fb.clear();
+        std::string reuse_note;
+        if (temporal) {
+            temporal_stats ts = render_temporal_frame(cam, sc.root(), sc.lights, fb, settings, *temporal, history,
+                                                      anim.motion_between(prev_time, time));
+            total_samples += ts.samples;
+            reuse_note = ", reaproveitados " + std::to_string(ts.reused) + " presos " + std::to_string(ts.clamped)
+                       + " recusados " + std::to_string(ts.rejected) + " fora " + std::to_string(ts.offscreen) + " amostras " + std::to_string(ts.samples);
+        } else {
+            total_samples += render_frame(cam, sc.root(), sc.lights, fb, settings);
+        }
+        {
+            trace_scope write_scope("write_ppm", "main");
+            std::ofstream out(filename);
+            fb.write_ppm(out);
+        }
+        auto t2 = clock::now();
+
+        std::cerr << "Quadro " << f << " (" << filename << "): update "
+                  << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, render "
+                  << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms, custo BVH x"
+                  << sc.accel->stats.cost_ratio << ", subarvores reconstruidas "
+                  << sc.accel->stats.partial_rebuilds << reuse_note << "\n";
+    }
+    std::cerr << "Sequencia: " << total_samples << " amostras em "
+              << std::chrono::duration<double, std::milli>(clock::now() - sequence_start).count() << " ms\n";
+}
+
+// Compara hit() com a referência lenta (hit_reference) em raios sorteados em volta da forma:
+// origens fora e dentro do sólido, direções quaisquer e também paralelas aos eixos. Depois mede
+// raios/s (acertos + erros) dos dois kernels na mesma lista.
+template <typename Shape>
+static long check_quadric(const Shape& shape, const char* name, long count) {
+    aabb box;
+    shape.bounding_box(box);
+    vec3 extent = box.maximum - box.minimum;
+    std::vector<ray> rays;
+    rays.reserve(count);
+    for (long k = 0; k < count; k++) {
+        point3 o;
+        if (k % 10 == 0) {
+            // Dentro da caixa (parte dentro do sólido: raios de refração)
+            o = box.minimum + vec3(random_double() * extent.x(), random_double() * extent.y(), random_double() * extent.z());
+        } else {
+            o = box.minimum - extent + vec3(3 * random_double() * extent.x(), 3 * random_double() * extent.y(),
+                                            3 * random_double() * extent.z());
+        }
+        vec3 d;
+        if (k % 20 == 1) d = vec3(0, random_double() < 0.5 ? -1 : 1, 0);               // Paralelo ao eixo
+        else if (k % 20 == 2) d = vec3(random_double(-1, 1), 0, random_double(-1, 1)); // Paralelo às tampas
+        else {
+            // Na direção de um ponto da caixa: boa parte dos raios acerta
+            point3 target = box.minimum + vec3(random_double() * extent.x(), random_double() * extent.y(),
+                                               random_double() * extent.z());
+            d = k % 3 == 0 ? vec3(random_double(-1, 1), random_double(-1, 1), random_double(-1, 1)) : target - o;
+        }
+        rays.push_back(ray(o, unit_vector(d)));
+    }
+
+    long hits = 0, mismatches = 0;
+    for (const ray& r : rays) {
+        hit_record a, b;
+        bool ha = shape.hit(r, 0.001, infinity, a);
+        bool hb = shape.hit_reference(r, 0.001, infinity, b);
+        hits += ha;
+        bool same = ha == hb;
+        if (same && ha) same = fabs(a.t - b.t) <= 1e-6 * (1 + fabs(b.t)) && dot(a.normal, b.normal) > 0.999;
+        if (!same) {
+            if (mismatches < 5)
+                std::cerr << "  " << name << " diferente: origem " << r.origin() << " direcao " << r.direction()
+                          << " -> " << (ha ? a.t : -1) << " / referencia " << (hb ? b.t : -1) << "\n";
+            mismatches++;
+        }
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto rate = [&](bool reference) {
+        long found = 0;
+        auto t0 = clock::now();
+        for (int pass = 0; pass < 4; pass++) {
+            for (const ray& r : rays) {
+                hit_record rec;
+                found += reference ? shape.hit_reference(r, 0.001, infinity, rec) : shape.hit(r, 0.001, infinity, rec);
+            }
+        }
+        double seconds = std::chrono::duration<double>(clock::now() - t0).count();
+        return found >= 0 ? 4.0 * rays.size() / seconds / 1e6 : 0.0;
+    };
+    double fast = rate(false), slow = rate(true);
+    std::cerr << name << ": " << rays.size() << " raios, " << hits << " acertos, " << mismatches
+              << " diferencas da referencia; " << fast << " Mraios/s (referencia " << slow << " Mraios/s)\n";
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    // Argumentos:
+    //   --frames N [--prefix nome]  renderiza uma animação em arquivos nome0000.ppm ...
+    //     [--temporal [--fresh-spp N]]  ... reaproveitando as amostras do quadro anterior (ver temporal.h)
+    //   --session                   sessão persistente lendo comandos da entrada padrão
+    //   --socket caminho            sessão persistente num socket Unix local
+    //   --threads N                 threads de render (padrão: todos os núcleos)
+    //   --coordinator endereco      distribui tiles para workers ("host:porta" ou "unix:/caminho")
+    //     [--spawn N] [--tile N]    ... criando N workers locais e com tiles de N pixels
+    //   --worker endereco           worker: conecta no coordenador e renderiza tiles
+    //   --forest N                  adiciona uma floresta de N instâncias em volta do altar
+    //   --depth N                   profundidade máxima de reflexão/refração
+    //   --no-shadow-cache           desliga o cache de oclusores dos raios de sombra
+    //   --check-quadrics N          valida cilindro/cone contra a referência com N raios e sai
+    //   --no-frustum-cull           raios primários percorrem a cena inteira (sem culling por tile)
+    //   --spp N                     amostras por pixel (padrão 20)
+    //   --denoise [--aov-spp N]     filtra a imagem final com o denoiser à-trous (ver denoise.h);
+    //                               com N > spp, as guias (albedo/normal/profundidade) recebem
+    //                               raios primários extras e a cor é filtrada sem o albedo
+    //   --texture arquivo.ppm       imagem no chão (mip-maps em tiles, ver image_texture.h),
+    //     [--texture-scale N]       ... repetida a cada N unidades (padrão 8)
+    //   --texture-cache MB          teto de memória do cache de tiles de textura (padrão 256)
+    //   --bake-floor CELULA         pré-calcula o xadrez do chão numa grade 3D esparsa (ver baked_texture.h)
+    //   --budget MS                 prévia com orçamento de tempo: resolução e amostras escolhidas
+    //                               pela vazão medida (ver budget.h); --spp vira o teto de amostras
+    //   --rock N                    grava uma rocha de ~N triângulos em rock.rtpm e a coloca atrás do altar
+    //   --mesh arquivo.rtpm         malha em páginas mapeadas sob demanda (ver paged_mesh.h)
+    //   --mesh-resident MB          teto do conjunto residente de páginas de malha (padrão 512)
+    //   --width N                   largura (e altura) da imagem (padrão 500)
+    //   --checkpoint arquivo.rtck   imagem num arquivo mapeado, retomada de onde parou se o
+    //     [--checkpoint-every S]    processo morrer; flush a cada S segundos (ver checkpoint.h)
+    //   --thumbnails N [--thumb-size S]  N miniaturas SxS (padrão 128) de ângulos diferentes como
+    //                               jobs simultâneos num pool de threads (ver render_job.h)
+    //   --trace arquivo.json        grava a linha do tempo (cena, tiles, shading, escrita) no formato
+    //                               do Chrome (about:tracing / ui.perfetto.dev), ver trace.h
+    int frames = 0;
+    const char* frame_prefix = "frame_";
+    bool session_mode = false;
+    const char* socket_path = nullptr;
+    render_settings settings;
+    const char* coordinator_address = nullptr;
+    const char* worker_address = nullptr;
+    int spawn_workers = 0;
+    coordinator_settings coord_settings;
+    long forest_instances = 0;
+    int samples_per_pixel = 20;
+    bool denoise_enabled = false;
+    int aov_samples_per_pixel = 0;
+    const char* texture_path = nullptr;
+    double texture_scale = 8.0;
+    double texture_cache_mb = 256.0;
+    double bake_cell = 0.0;
+    double budget_ms = 0.0;
+    bool temporal_enabled = false;
+    temporal_settings temporal;
+    long rock_triangles = 0;
+    long check_rays = 0;
+    const char* mesh_path = nullptr;
+    double mesh_resident_mb = 512.0;
+    const char* trace_path = nullptr;
+    int width_arg = 500;
+    const char* checkpoint_path = nullptr;
+    checkpoint_settings checkpoint;
+    int thumbnails = 0;
+    int thumb_size = 128;
+    for (int a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--frames") && a+1 < argc) frames = atoi(argv[++a]);
+        else if (!strcmp(argv[a], "--prefix") && a+1 < argc) frame_prefix = argv[++a];
+        else if (!strcmp(argv[a], "--session")) session_mode = true;
+        else if (!strcmp(argv[a], "--socket") && a+1 < argc) socket_path = argv[++a];
+        else if (!strcmp(argv[a], "--threads") && a+1 < argc) settings.threads = atoi(argv[++a]);
+        else if (!strcmp(argv[a], "--coordinator") && a+1 < argc) coordinator_address = argv[++a];
+        else if (!strcmp(argv[a], "--worker") && a+1 < argc) worker_address = argv[++a];
+        else if (!strcmp(argv[a], "--spawn") && a+1 < argc) spawn_workers = atoi(argv[++a]);
+        else if (!strcmp(argv[a], "--tile") && a+1 < argc) coord_settings.tile_size = atoi(argv[++a]);
+        else if (!strcmp(argv[a], "--forest") && a+1 < argc) forest_instances = atol(argv[++a]);
+        else if (!strcmp(argv[a], "--depth") && a+1 < argc) settings.trace.max_depth = atoi(argv[++a]);
+        else if (!strcmp(argv[a], "--no-shadow-cache")) settings.trace.shadow_cache = false;
+        else if (!strcmp(argv[a], "--no-frustum-cull")) settings.frustum_culling = false;
+        else if (!strcmp(argv[a], "--spp") && a+1 < argc) samples_per_pixel = atoi(argv[++a]);
+        else if (!strcmp(argv[a], "--denoise")) denoise_enabled = true;
+        else if (!strcmp(argv[a], "--aov-spp") && a+1 < argc) aov_samples_per_pixel = atoi(argv[++a]);
+        else if (!strcmp(argv[a], "--texture") && a+1 < argc) texture_path = argv[++a];
+        else if (!strcmp(argv[a], "--texture-scale") && a+1 < argc) texture_scale = atof(argv[++a]);
+        else if (!strcmp(argv[a], "--texture-cache") && a+1 < argc) texture_cache_mb = atof(argv[++a]);
+        else if (!strcmp(argv[a], "--bake-floor") && a+1 < argc) bake_cell = atof(argv[++a]);
+        else if (!strcmp(argv[a], "--budget") && a+1 < argc) budget_ms = atof(argv[++a]);
+        else if (!strcmp(argv[a], "--temporal")) temporal_enabled = true;
+        else if (!strcmp(argv[a], "--fresh-spp") && a+1 < argc) temporal.fresh_spp = std::max(1, atoi(argv[++a]));
+        else if (!strcmp(argv[a], "--check-quadrics") && a+1 < argc) check_rays = atol(argv[++a]);
+        else if (!strcmp(argv[a], "--rock") && a+1 < argc) rock_triangles = atol(argv[++a]);
+        else if (!strcmp(argv[a], "--mesh") && a+1 < argc) mesh_path = argv[++a];
+        else if (!strcmp(argv[a], "--mesh-resident") && a+1 < argc) mesh_resident_mb = atof(argv[++a]);
+        else if (!strcmp(argv[a], "--trace") && a+1 < argc) trace_path = argv[++a];
+        else if (!strcmp(argv[a], "--thumbnails") && a+1 < argc) thumbnails = atoi(argv[++a]);
+        else if (!strcmp(argv[a], "--thumb-size") && a+1 < argc) thumb_size = std::max(2, atoi(argv[++a]));
+        else if (!strcmp(argv[a], "--width") && a+1 < argc) width_arg = std::max(2, atoi(argv[++a]));
+        else if (!strcmp(argv[a], "--checkpoint") && a+1 < argc) checkpoint_path = argv[++a];
+        else if (!strcmp(argv[a], "--checkpoint-every") && a+1 < argc) checkpoint.flush_seconds = atof(argv[++a]);
+    }
+    if (trace_path) {
+        trace_recorder::global().enable();
+        trace_recorder::global().name_thread("main");
+    }
+
+    if (budget_ms > 0 && denoise_enabled) {
+        // A prévia é ampliada de uma resolução menor e não guarda albedo/normal/profundidade
+        std::cerr << "--budget e --denoise nao podem ser usados juntos (a previa nao tem as guias do denoiser)\n";
+        return 1;
+    }
+
+    if (check_rays > 0) {
+        long mismatches = check_quadric(cylinder(3.0, 1.5, nullptr), "Cilindro", check_rays)
+                        + check_quadric(cone(4.0, 1.0, nullptr), "Cone", check_rays);
+        return mismatches > 0 ? 1 : 0;
+    }
+
     // Configurações
     double zoom_vfov = 40.0; 
     const auto aspect_ratio = 1.0; 
-    const int image_width = 500;
+    const int image_width = width_arg;
     const int image_height = static_cast<int>(image_width / aspect_ratio);
-    const int samples_per_pixel = 20;
-
-    // Mundo
-    hittable_list world;
-    auto checker = make_shared<checker_texture>(color(0.2, 0.3, 0.1), color(0.9, 0.9, 0.9));
+    settings.samples_per_pixel = std::max(1, samples_per_pixel);
+
+    // Mundo (objetos, materiais e texturas vivem na arena da cena, ver arena.h)
+    trace_scope scene_scope("scene_build", "main");
+    scene sc;
+    hittable_list& world = sc.world;
+    shared_ptr<texture> floor_texture = sc.arena.make<checker_texture>(color(0.2, 0.3, 0.1), color(0.9, 0.9, 0.9));
+    auto texture_tiles = sc.arena.make<texture_cache>(static_cast<size_t>(texture_cache_mb * 1024 * 1024));
+    if (texture_path) {
+        auto t0 = std::chrono::steady_clock::now();
+        auto image = sc.arena.make<image_texture>(texture_tiles);
+        image->planar_scale = texture_scale;
+        if (image->load(texture_path)) {
+            floor_texture = image;
+            std::cerr << "Textura " << texture_path << ": " << image->width() << "x" << image->height()
+                      << ", " << image->level_count() << " niveis, preparada em "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() << " ms\n";
+        } else {
+            std::cerr << "Textura: nao foi possivel ler " << texture_path << " (PPM P3/P6), usando o xadrez\n";
+        }
+    }
 
     // Materiais Phong
-    auto mat_floor  = make_shared<material>(checker, 0.1, 10.0);
-    auto mat_gold   = make_shared<material>(color(0.8, 0.6, 0.2), 0.2, 128.0, color(1, 0.9, 0.5));
-    auto mat_silver = make_shared<material>(color(0.7, 0.7, 0.7), 0.1, 200.0, color(1,1,1));
-    auto mat_ruby   = make_shared<material>(color(0.9, 0.1, 0.1), 0.2, 100.0);
-    auto mat_blue   = make_shared<material>(color(0.1, 0.2, 0.5), 0.1, 64.0);
+    auto mat_floor  = sc.add_material("floor",  sc.arena.make<material>(floor_texture, 0.1, 10.0));
+    auto mat_gold   = sc.add_material("gold",   sc.arena.make<material>(color(0.8, 0.6, 0.2), 0.2, 128.0, color(1, 0.9, 0.5)));
+    auto mat_silver = sc.add_material("silver", sc.arena.make<material>(color(0.7, 0.7, 0.7), 0.1, 200.0, color(1,1,1)));
+    auto mat_ruby   = sc.add_material("ruby",   sc.arena.make<material>(color(0.9, 0.1, 0.1), 0.2, 100.0));
+    auto mat_blue   = sc.add_material("blue",   sc.arena.make<material>(color(0.1, 0.2, 0.5), 0.1, 64.0));
+    mat_gold->kr   = color(0.6, 0.45, 0.15); // Metais: reflexo tingido pela cor do metal
+    mat_silver->kr = color(0.7, 0.7, 0.7);
 
     // Objetos (Cena Altar)
-    world.add(make_shared<sphere>(point3(0,-1000,0), 1000, mat_floor)); // Chão
+    world.add(sc.arena.make<sphere>(point3(0,-1000,0), 1000, mat_floor)); // Chão
 
-    auto cyl_base = make_shared<cylinder>(3.0, 1.5, mat_gold);
+    auto cyl_base = sc.arena.make<cylinder>(3.0, 1.5, mat_gold);
     mat4 cyl_pos = mat4::translate(vec3(0, 1.5, 0));
     mat4 cyl_inv = mat4::translate(vec3(0, -1.5, 0));
-    world.add(make_shared<instance>(cyl_base, cyl_pos, cyl_inv)); // Altar
+    world.add(sc.arena.make<instance>(cyl_base, cyl_pos, cyl_inv)); // Altar
 
-    world.add(make_shared<sphere>(point3(0, 4.0, 0), 1.0, mat_ruby)); // Esfera
+    world.add(sc.arena.make<sphere>(point3(0, 4.0, 0), 1.0, mat_ruby)); // Esfera
 
-    auto cone_base = make_shared<cone>(4.0, 1.0, mat_silver);
+    auto cone_base = sc.arena.make<cone>(4.0, 1.0, mat_silver);
     mat4 cone_pos = mat4::translate(vec3(4, 0, 0));
     mat4 cone_inv = mat4::translate(vec3(-4, 0, 0));
-    world.add(make_shared<instance>(cone_base, cone_pos, cone_inv)); // Cone
+    auto cone_inst = sc.arena.make<instance>(cone_base, cone_pos, cone_inv);
+    world.add(cone_inst); // Cone
 
-    auto box_base = make_shared<box_mesh>(point3(0,0,0), point3(1,1,1), mat_blue);
+    auto box_base = sc.arena.make<box_mesh>(point3(0,0,0), point3(1,1,1), mat_blue);
     mat4 box_trans = mat4::translate(vec3(-4, 1, 1)) * mat4::rotate_y(degrees_to_radians(45));
     mat4 box_inv = mat4::rotate_y(degrees_to_radians(-45)) * mat4::translate(vec3(4, -1, -1)); 
-    world.add(make_shared<instance>(box_base, box_trans, box_inv)); // Cubo
+    auto box_inst = sc.arena.make<instance>(box_base, box_trans, box_inv);
+    world.add(box_inst); // Cubo
 
     // Reflexão (Bonus 1.4.5) - Cópia Espelhada do Cone
     mat4 mirror_matrix = mat4::reflection(true, false, false); // Espelha X
     mat4 mirror_pos = mirror_matrix * cone_pos;
     mat4 mirror_pos_inv = cone_inv * mirror_matrix; // Inversa é igual
-    world.add(make_shared<instance>(cone_base, mirror_pos, mirror_pos_inv));
+    auto mirror_inst = sc.arena.make<instance>(cone_base, mirror_pos, mirror_pos_inv);
+    world.add(mirror_inst);
+
+    // Floresta (tabela compacta de instâncias): árvores = tronco (cilindro) + copa (cone)
+    if (forest_instances > 0) {
+        using clock = std::chrono::steady_clock;
+        auto t0 = clock::now();
+
+        auto forest = sc.arena.make<instance_table>();
+        auto mat_bark = sc.add_material("bark", sc.arena.make<material>(color(0.35, 0.2, 0.1), 0.1, 8.0, color(0.1, 0.1, 0.1)));
+        uint32_t trunk = forest->add_geometry(sc.arena.make<cylinder>(1.0, 0.15, mat_bark));
+        uint32_t crown = forest->add_geometry(sc.arena.make<cone>(2.0, 0.8, mat_silver));
+        uint32_t leaves[3] = {
+            forest->add_material(sc.add_material("leaf_dark",  sc.arena.make<material>(color(0.1, 0.35, 0.1), 0.1, 16.0, color(0.2, 0.2, 0.2)))),
+            forest->add_material(sc.add_material("leaf_light", sc.arena.make<material>(color(0.3, 0.6, 0.2), 0.1, 16.0, color(0.2, 0.2, 0.2)))),
+            forest->add_material(sc.add_material("leaf_dry",   sc.arena.make<material>(color(0.6, 0.5, 0.2), 0.1, 16.0, color(0.2, 0.2, 0.2))))};
+
+        long trees = (forest_instances + 1) / 2;
+        double outer = 8.0 + 0.6 * sqrt(double(trees)); // Densidade mais ou menos constante
+        forest->reserve(2 * trees);
+        for (long k = 0; k < trees; k++) {
+            double angle = random_double(0, 2*pi);
+            double dist = sqrt(random_double(8.0*8.0, outer*outer));
+            double s = random_double(0.6, 1.4);
+            mat4 place = mat4::translate(vec3(dist*cos(angle), 0, dist*sin(angle)))
+                       * mat4::rotate_y(random_double(0, 2*pi)) * mat4::scale(vec3(s, s, s));
+            forest->add(trunk, place * mat4::translate(vec3(0, 0.5, 0)));
+            forest->add(crown, place * mat4::translate(vec3(0, 1.0, 0)), leaves[k % 3]);
+        }
+        forest->build();
+        world.add(forest);
+
+        std::cerr << "Floresta: " << forest->instances.size() << " instancias, "
+                  << forest->memory_bytes() / (1024.0 * 1024.0) << " MB, montada em "
+                  << std::chrono::duration<double, std::milli>(clock::now() - t0).count() << " ms\n";
+    }
+
+    // Rocha "escaneada": esfera deformada em latitude/longitude, convertida para páginas em disco
+    auto mesh_pages = sc.arena.make<mesh_page_cache>(static_cast<size_t>(mesh_resident_mb * 1024 * 1024));
+    if (rock_triangles > 0 && !mesh_path) {
+        auto t0 = std::chrono::steady_clock::now();
+        int rows = std::max(4, static_cast<int>(sqrt(rock_triangles / 4.0)));
+        int cols = 2 * rows;
+        std::vector<point3> vertices;
+        std::vector<mesh_face> faces;
+        vertices.reserve(static_cast<size_t>(rows + 1) * cols);
+        faces.reserve(static_cast<size_t>(2) * rows * cols);
+        for (int i = 0; i <= rows; i++) {
+            double theta = pi * i / rows;
+            for (int k = 0; k < cols; k++) {
+                double phi = 2 * pi * k / cols;
+                vec3 d(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+                double bump = 0.15 * sin(3*d.x() + 1) * sin(4*d.y()) + 0.08 * sin(9*d.z() + 5*d.x())
+                            + 0.02 * sin(40*d.x()) * sin(37*d.y() + 31*d.z());
+                vertices.push_back(point3(0, 1.6, -6.5) + 2.2 * (1 + bump) * vec3(1.3*d.x(), 0.8*d.y(), d.z()));
+            }
+        }
+        for (int i = 0; i < rows; i++) {
+            for (int k = 0; k < cols; k++) {
+                uint32_t a = i*cols + k, b = i*cols + (k+1) % cols;
+                uint32_t c = a + cols, d = b + cols;
+                uint32_t m = i < rows / 3 ? 1 : 0; // Topo com musgo
+                faces.push_back(mesh_face{{a, c, b}, m});
+                faces.push_back(mesh_face{{b, c, d}, m});
+            }
+        }
+        mesh_path = "rock.rtpm";
+        if (!write_paged_mesh(mesh_path, vertices, faces)) {
+            std::cerr << "Rocha: nao foi possivel gravar " << mesh_path << "\n";
+            mesh_path = nullptr;
+        } else {
+            std::cerr << "Rocha: " << faces.size() << " triangulos gravados em " << mesh_path << " em "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() << " ms\n";
+        }
+    }
+    if (mesh_path) {
+        auto paged = sc.arena.make<paged_mesh>(mesh_pages);
+        if (paged->open(mesh_path)) {
+            paged->materials.add(sc.add_material("stone", sc.arena.make<material>(color(0.45, 0.42, 0.38), 0.1, 12.0)));
+            paged->materials.add(sc.add_material("moss",  sc.arena.make<material>(color(0.25, 0.4, 0.15), 0.1, 8.0)));
+            // Handles além dos dois materiais da rocha reaproveitam a pedra
+            while (paged->materials.size() < paged->materials_needed())
+                paged->materials.items.push_back(paged->materials.items[0]);
+            world.add(paged);
+            std::cerr << "Malha " << mesh_path << ": " << paged->faces() << " triangulos em " << paged->page_count()
+                      << " paginas, " << paged->page_bytes() / (1024.0 * 1024.0) << " MB no disco, "
+                      << paged->memory_bytes() / 1024.0 << " KB fixos\n";
+        } else {
+            std::cerr << "Malha: nao foi possivel abrir " << mesh_path << "\n";
+        }
+    }
+
+    // Estrutura de aceleração sobre os objetos da cena
+    {
+        trace_scope bvh_scope("bvh_build", "main");
+        sc.build_accel();
+    }
+    scene_scope.end();
 
     // Luz
     PointLight main_light;
     main_light.position = point3(10, 20, 10);
     main_light.intensity = color(1.0, 1.0, 1.0);
+    sc.lights.push_back(main_light);
 
     // Câmera
     point3 lookfrom(0, 8, 12);
     point3 lookat(0, 2, 0);
     vec3 vup(0, 1, 0);
-    auto dist_to_focus = (lookfrom - lookat).length();
-    camera cam(lookfrom, lookat, vup, zoom_vfov, aspect_ratio, 0.0, dist_to_focus);
+    sc.view = view_params{lookfrom, lookat, vup, zoom_vfov, 0.0};
+    camera cam = sc.view.make_camera(aspect_ratio);
+
+    // Baking do chão: só onde a câmera vê o chão (o resto cai na textura original)
+    shared_ptr<baked_texture> baked_floor;
+    if (bake_cell > 0 && !texture_path) {
+        auto t0 = std::chrono::steady_clock::now();
+        baked_floor = sc.arena.make<baked_texture>(mat_floor->kd);
+        baked_floor->bake_solid(bake_cell, collect_surface_points(cam, sc.root(), mat_floor.get(), image_width, image_height));
+        mat_floor->kd = baked_floor;
+        std::cerr << "Chao pre-calculado: " << baked_floor->brick_count() << " blocos, "
+                  << baked_floor->memory_bytes() / (1024.0 * 1024.0) << " MB em "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count()
+                  << " ms; erro max " << baked_floor->error.max_abs << ", rms " << baked_floor->error.rms
+                  << " (" << baked_floor->error.probes << " pontos)\n";
+    }
+
+#ifndef _WIN32
+    // --- MODO DISTRIBUÍDO ---
+    if (worker_address) {
+        int tiles = run_worker(sc, worker_address, settings);
+        if (tiles < 0) {
+            std::cerr << "Worker: nao foi possivel conectar em " << worker_address << "\n";
+            return 1;
+        }
+        std::cerr << "Worker: " << tiles << " tiles renderizados\n";
+        return 0;
+    }
+
+    if (coordinator_address) {
+        // Workers locais: a cena já está montada, o fork só herda a memória
+        for (int k = 0; k < spawn_workers; k++) {
+            if (fork() == 0) {
+                run_worker(sc, coordinator_address, settings);
+                _exit(0);
+            }
+        }
+
+        std::cerr << "Coordenador escutando em " << coordinator_address << "...\n";
+        framebuffer fb(image_width, image_height);
+        render_coordinator coordinator;
+        coordinator.settings = coord_settings;
+        if (!coordinator.render(sc.view, fb, settings.samples_per_pixel, coordinator_address)) {
+            std::cerr << "Falha ao escutar em " << coordinator_address << "\n";
+            return 1;
+        }
+        fb.write_ppm(std::cout);
+        std::cerr << "Renderizacao Distribuida Concluida! workers " << coordinator.stats.workers_seen
+                  << ", perdidos " << coordinator.stats.workers_lost
+                  << ", tiles reenviados " << coordinator.stats.tiles_reassigned
+                  << ", resultados duplicados " << coordinator.stats.duplicate_results << "\n";
+        while (spawn_workers-- > 0) wait(nullptr);
+        return 0;
+    }
+#endif
+
+    if (session_mode || socket_path) {
+        render_session session(sc, image_width, image_height, settings);
+#ifndef _WIN32
+        if (socket_path) {
+            if (!serve_unix_socket(session, socket_path)) {
+                std::cerr << "Falha ao abrir o socket " << socket_path << "\n";
+                return 1;
+            }
+            return 0;
+        }
+#endif
+        std::cerr << "Sessao pronta. Digite comandos (quit para sair).\n";
+        session.run(std::cin, std::cout);
+        return 0;
+    }
+
+    if (frames > 0) {
+        // Turntable: o par de cones gira em volta do altar, o cubo gira no lugar e a câmera sobe
+        scene_animation anim;
+        transform_track orbit;
+        orbit.add_key(0.0, vec3(0,0,0), vec3(0,1,0), 0.0);
+        orbit.add_key(1.0, vec3(0,0,0), vec3(0,1,0), 2*pi);
+        anim.animate(cone_inst, orbit);
+        anim.animate(mirror_inst, orbit);
+
+        // Gira o cubo em torno do próprio centro (leva ao centro, gira, devolve)
+        point3 box_center = (box_trans * vec4(point3(0.5, 0.5, 0.5), 1.0)).to_vec3();
+        transform_track spin;
+        spin.add_key(0.0, vec3(0,0,0));
+        for (int k = 1; k <= 16; k++) {
+            double angle = k * pi / 8;
+            vec3 offset = box_center - (mat4::rotate(vec3(0,1,0), angle) * vec4(box_center, 1.0)).to_vec3();
+            spin.add_key(k / 16.0, offset, vec3(0,1,0), angle);
+        }
+        anim.animate(box_inst, spin);
+
+        anim.camera_keys.add_key(0.0, lookfrom, lookat, vup, zoom_vfov);
+        anim.camera_keys.add_key(1.0, point3(0, 12, 12), lookat, vup, zoom_vfov);
+
+        std::cerr << "Renderizando " << frames << " quadros...\n";
+        render_animation(anim, sc, aspect_ratio, image_width, image_height,
+                         settings, frames, frame_prefix, temporal_enabled ? &temporal : nullptr);
+        std::cerr << "Animacao Concluida!\n";
+        if (trace_path) write_trace(trace_path);
+        return 0;
+    }
+
+    // --- MODO MINIATURAS (jobs assíncronos) ---
+    // Uma miniatura por ângulo em volta do altar, todas submetidas de uma vez ao mesmo pool
+    if (thumbnails > 0) {
+        render_pool pool(settings.threads);
+        std::atomic<int> tiles_done{0};
+        render_job_callbacks callbacks;
+        callbacks.on_progress = [&](int, int) { tiles_done++; };
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<render_job> jobs;
+        for (int k = 0; k < thumbnails; k++) {
+            double angle = 2 * pi * k / thumbnails;
+            view_params view = sc.view;
+            view.lookfrom = lookat + vec3(12 * sin(angle), 8, 12 * cos(angle));
+            jobs.push_back(pool.submit(sc, view.make_camera(1.0), thumb_size, thumb_size, settings, callbacks));
+        }
+
+        long samples = 0;
+        int cancelled = 0;
+        for (int k = 0; k < thumbnails; k++) {
+            render_result result = jobs[k].get();
+            samples += result.samples;
+            if (result.cancelled) cancelled++;
+            char filename[64];
+            std::snprintf(filename, sizeof(filename), "thumb_%04d.ppm", k);
+            std::ofstream out(filename);
+            result.image.write_ppm(out);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << "Miniaturas: " << thumbnails << " de " << thumb_size << "x" << thumb_size << " em " << ms
+                  << " ms (" << 1000.0 * thumbnails / ms << "/s) com " << pool.thread_count() << " threads, "
+                  << tiles_done << " tiles, " << samples << " amostras, " << cancelled << " canceladas\n";
+        if (trace_path) write_trace(trace_path);
+        return 0;
+    }
+
+    // --- MODO CHECKPOINT (imagens grandes) ---
+    // As amostras vão para o arquivo mapeado em vez do framebuffer; rodar de novo com o mesmo
+    // arquivo continua dos tiles que faltam e no fim a imagem sai no cout como no modo normal.
+    if (checkpoint_path) {
+        checkpoint_framebuffer cfb;
+        bool resumed = false;
+        if (!cfb.open(checkpoint_path, image_width, image_height, settings.tile_size, resumed)) {
+            std::cerr << "Checkpoint: nao foi possivel abrir " << checkpoint_path << " para "
+                      << image_width << "x" << image_height << " (arquivo de outra resolucao?)\n";
+            return 1;
+        }
+        std::cerr << "Checkpoint " << checkpoint_path << ": " << cfb.file_bytes() / (1024.0 * 1024.0) << " MB, "
+                  << (resumed ? "retomando, " : "novo, ") << cfb.tiles_at(settings.samples_per_pixel) << "/"
+                  << cfb.tile_count() << " tiles prontos\n";
+        ray_stats rays;
+        auto render_start = std::chrono::steady_clock::now();
+        checkpoint_report cr;
+        {
+            trace_scope render_scope("render", "main");
+            cr = render_checkpointed(cam, sc.root(), sc.lights, cfb, settings.samples_per_pixel,
+                                     settings, checkpoint, true, &rays);
+        }
+        std::cerr << "\nRenderizacao Concluida! ("
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - render_start).count()
+                  << " ms): " << cr.tiles_rendered << " tiles renderizados, " << cr.tiles_skipped << " ja prontos, "
+                  << cr.samples << " amostras, " << cr.flushes << " flushes\n";
+        {
+            trace_scope write_scope("write_ppm", "main");
+            cfb.write_ppm(std::cout);
+            std::cout.flush();
+        }
+        std::cerr << "Raios/sombras por profundidade: ";
+        rays.print(std::cerr);
+        std::cerr << "\n";
+        if (trace_path) write_trace(trace_path);
+        return 0;
+    }
 
     // --- MODO RENDERIZAÇÃO (Para Arquivo) ---
     // Importante: Usamos cerr para logs e cout para imagem
     std::cerr << "Iniciando Renderizacao...\n";
-    std::cout << "P3\n" << image_width << ' ' << image_height << "\n255\n";
-
-    for (int j = image_height-1; j >= 0; --j) {
-        if (j % 50 == 0) std::cerr << "\rLinhas restantes: " << j << ' ' << std::flush;
-        for (int i = 0; i < image_width; ++i) {
-            color pixel_color(0, 0, 0);
-            for (int s = 0; s < samples_per_pixel; ++s) {
-                auto u = (i + random_double()) / (image_width-1);
-                auto v = (j + random_double()) / (image_height-1);
-                ray r = cam.get_ray(u, v);
-                pixel_color += ray_color(r, world, main_light);
-            }
-            auto r = pixel_color.x();
-            auto g = pixel_color.y();
-            auto b = pixel_color.z();
-            auto scale = 1.0 / samples_per_pixel;
-            r = sqrt(scale * r); g = sqrt(scale * g); b = sqrt(scale * b);
-            std::cout << static_cast<int>(256 * clamp(r, 0.0, 0.999)) << ' '
-                      << static_cast<int>(256 * clamp(g, 0.0, 0.999)) << ' '
-                      << static_cast<int>(256 * clamp(b, 0.0, 0.999)) << '\n';
+    framebuffer fb(image_width, image_height);
+    if (denoise_enabled) fb.enable_aovs();
+    ray_stats rays;
+    auto render_start = std::chrono::steady_clock::now();
+    trace_scope render_scope("render", "main");
+    if (budget_ms > 0) {
+        budget_settings bs;
+        bs.budget_ms = budget_ms;
+        bs.max_spp = settings.samples_per_pixel;
+        budget_state state;
+        budget_report br = render_budgeted(cam, sc.root(), sc.lights, fb, settings, bs, state, &rays);
+        std::cerr << "Orcamento " << budget_ms << " ms: " << br.width << "x" << br.height << " (escala "
+                  << br.scale << "), " << br.passes << " passadas, " << br.samples << " amostras, cobertura "
+                  << 100.0 * br.coverage << "%, render " << br.render_ms << " ms + final " << br.resolve_ms
+                  << " ms = " << br.elapsed_ms << " ms\n";
+    } else {
+        render_frame(cam, sc.root(), sc.lights, fb, settings, true, &rays);
+    }
+    render_scope.end();
+    double render_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - render_start).count();
+    std::cerr << "\nRenderizacao Concluida! (" << render_ms << " ms)\n";
+    if (denoise_enabled) {
+        trace_scope denoise_scope("denoise", "main");
+        denoise_settings ds;
+        ds.threads = settings.threads;
+        auto denoise_start = std::chrono::steady_clock::now();
+        if (aov_samples_per_pixel > settings.samples_per_pixel) {
+            render_aov_region(cam, sc.root(), fb, pixel_region{0, 0, fb.width, fb.height},
+                              aov_samples_per_pixel, settings);
+            ds.demodulate = true;
         }
+        denoise(fb, ds);
+        std::cerr << "Denoise: " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - denoise_start).count()
+                  << " ms\n";
+    }
+    {
+        // A imagem vai inteira para o cout antes dos logs: é aqui que o main() fica parado na escrita
+        trace_scope write_scope("write_ppm", "main");
+        fb.write_ppm(std::cout);
+        std::cout.flush();
     }
-    std::cerr << "\nRenderizacao Concluida!\n";
+    std::cerr << "Raios/sombras por profundidade: ";
+    rays.print(std::cerr);
+    std::cerr << "\n";
+    if (texture_path) texture_tiles->print(std::cerr);
+    if (baked_floor) std::cerr << "Chao pre-calculado: " << baked_floor->fallbacks << " buscas fora dos blocos\n";
+    if (mesh_path) mesh_pages->print(std::cerr);
+    if (trace_path) write_trace(trace_path);
 
     // --- MODO INTERATIVO (Picking) ---
     std::cerr << "\n============================================\n";
@@ -193,7 +732,7 @@ int main() {
             // Executa o Picking Matemático
             // Invertemos Y aqui porque no loop de render j vai de height-1 até 0
             // Se o usuário digitar 0 (fundo), queremos o j=0.
-            perform_pick(px, py, image_width, image_height, cam, world);
+            perform_pick(px, py, image_width, image_height, cam, sc.root());
         } else {
             std::cerr << "Coordenada invalida! Use X entre 0-" << image_width-1 << " e Y entre 0-" << image_height-1 << "\n";
         }